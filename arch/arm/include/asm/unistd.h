@@ -410,6 +410,18 @@
 #define __NR_set_reserve		(__NR_SYSCALL_BASE+379)
 #define __NR_cancel_reserve 	(__NR_SYSCALL_BASE+380)
 #define __NR_end_job		 	(__NR_SYSCALL_BASE+381)
+#define __NR_profile_reserve		(__NR_SYSCALL_BASE+382)
+#define __NR_set_reserve_adaptive	(__NR_SYSCALL_BASE+383)
+#define __NR_set_reserve_type		(__NR_SYSCALL_BASE+384)
+#define __NR_set_reserve_ex		(__NR_SYSCALL_BASE+385)
+#define __NR_set_overrun_policy		(__NR_SYSCALL_BASE+386)
+#define __NR_create_reserve_group	(__NR_SYSCALL_BASE+387)
+#define __NR_join_reserve_group		(__NR_SYSCALL_BASE+388)
+#define __NR_destroy_reserve_group	(__NR_SYSCALL_BASE+389)
+/* 390 */
+#define __NR_set_reserve_blocking	(__NR_SYSCALL_BASE+390)
+#define __NR_list_rt_threads_ex		(__NR_SYSCALL_BASE+391)
+#define __NR_rt_thread_watch		(__NR_SYSCALL_BASE+392)
 
 /*
  * The following SWIs are ARM private.
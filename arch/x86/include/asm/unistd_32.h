@@ -352,10 +352,28 @@
 #define __NR_syncfs             344
 #define __NR_sendmmsg		345
 #define __NR_setns		346
+/* rtes sys_xxxx below this line */
+#define __NR_calc		347
+#define __NR_count_rt_threads	348
+#define __NR_list_rt_threads	349
+#define __NR_set_reserve	350
+#define __NR_cancel_reserve	351
+#define __NR_end_job		352
+#define __NR_profile_reserve	353
+#define __NR_set_reserve_adaptive	354
+#define __NR_set_reserve_type	355
+#define __NR_set_reserve_ex	356
+#define __NR_set_overrun_policy	357
+#define __NR_create_reserve_group	358
+#define __NR_join_reserve_group	359
+#define __NR_destroy_reserve_group	360
+#define __NR_set_reserve_blocking	361
+#define __NR_list_rt_threads_ex	362
+#define __NR_rt_thread_watch	363
 
 #ifdef __KERNEL__
 
-#define NR_syscalls 347
+#define NR_syscalls 364
 
 #define __ARCH_WANT_IPC_PARSE_VERSION
 #define __ARCH_WANT_OLD_READDIR
@@ -683,6 +683,41 @@ __SYSCALL(__NR_sendmmsg, sys_sendmmsg)
 __SYSCALL(__NR_setns, sys_setns)
 #define __NR_getcpu				309
 __SYSCALL(__NR_getcpu, sys_getcpu)
+/* rtes sys_xxxx below this line */
+#define __NR_calc				310
+__SYSCALL(__NR_calc, sys_calc)
+#define __NR_count_rt_threads			311
+__SYSCALL(__NR_count_rt_threads, sys_count_rt_threads)
+#define __NR_list_rt_threads			312
+__SYSCALL(__NR_list_rt_threads, sys_list_rt_threads)
+#define __NR_set_reserve			313
+__SYSCALL(__NR_set_reserve, sys_set_reserve)
+#define __NR_cancel_reserve			314
+__SYSCALL(__NR_cancel_reserve, sys_cancel_reserve)
+#define __NR_end_job				315
+__SYSCALL(__NR_end_job, sys_end_job)
+#define __NR_profile_reserve			316
+__SYSCALL(__NR_profile_reserve, sys_profile_reserve)
+#define __NR_set_reserve_adaptive		317
+__SYSCALL(__NR_set_reserve_adaptive, sys_set_reserve_adaptive)
+#define __NR_set_reserve_type			318
+__SYSCALL(__NR_set_reserve_type, sys_set_reserve_type)
+#define __NR_set_reserve_ex			319
+__SYSCALL(__NR_set_reserve_ex, sys_set_reserve_ex)
+#define __NR_set_overrun_policy			320
+__SYSCALL(__NR_set_overrun_policy, sys_set_overrun_policy)
+#define __NR_create_reserve_group		321
+__SYSCALL(__NR_create_reserve_group, sys_create_reserve_group)
+#define __NR_join_reserve_group			322
+__SYSCALL(__NR_join_reserve_group, sys_join_reserve_group)
+#define __NR_destroy_reserve_group		323
+__SYSCALL(__NR_destroy_reserve_group, sys_destroy_reserve_group)
+#define __NR_set_reserve_blocking		324
+__SYSCALL(__NR_set_reserve_blocking, sys_set_reserve_blocking)
+#define __NR_list_rt_threads_ex			325
+__SYSCALL(__NR_list_rt_threads_ex, sys_list_rt_threads_ex)
+#define __NR_rt_thread_watch			326
+__SYSCALL(__NR_rt_thread_watch, sys_rt_thread_watch)
 
 #ifndef __NO_STUBS
 #define __ARCH_WANT_OLD_READDIR
@@ -686,8 +686,44 @@ __SYSCALL(__NR_setns, sys_setns)
 #define __NR_sendmmsg 269
 __SC_COMP(__NR_sendmmsg, sys_sendmmsg, compat_sys_sendmmsg)
 
+/* rtes sys_xxxx below this line, no compat wrappers for struct timespec */
+#define __NR_calc 270
+__SYSCALL(__NR_calc, sys_calc)
+#define __NR_count_rt_threads 271
+__SYSCALL(__NR_count_rt_threads, sys_count_rt_threads)
+#define __NR_list_rt_threads 272
+__SYSCALL(__NR_list_rt_threads, sys_list_rt_threads)
+#define __NR_set_reserve 273
+__SC_COMP(__NR_set_reserve, sys_set_reserve, sys_ni_syscall)
+#define __NR_cancel_reserve 274
+__SYSCALL(__NR_cancel_reserve, sys_cancel_reserve)
+#define __NR_end_job 275
+__SYSCALL(__NR_end_job, sys_end_job)
+#define __NR_profile_reserve 276
+__SC_COMP(__NR_profile_reserve, sys_profile_reserve, sys_ni_syscall)
+#define __NR_set_reserve_adaptive 277
+__SC_COMP(__NR_set_reserve_adaptive, sys_set_reserve_adaptive, sys_ni_syscall)
+#define __NR_set_reserve_type 278
+__SC_COMP(__NR_set_reserve_type, sys_set_reserve_type, sys_ni_syscall)
+#define __NR_set_reserve_ex 279
+__SC_COMP(__NR_set_reserve_ex, sys_set_reserve_ex, sys_ni_syscall)
+#define __NR_set_overrun_policy 280
+__SYSCALL(__NR_set_overrun_policy, sys_set_overrun_policy)
+#define __NR_create_reserve_group 281
+__SC_COMP(__NR_create_reserve_group, sys_create_reserve_group, sys_ni_syscall)
+#define __NR_join_reserve_group 282
+__SYSCALL(__NR_join_reserve_group, sys_join_reserve_group)
+#define __NR_destroy_reserve_group 283
+__SYSCALL(__NR_destroy_reserve_group, sys_destroy_reserve_group)
+#define __NR_set_reserve_blocking 284
+__SC_COMP(__NR_set_reserve_blocking, sys_set_reserve_blocking, sys_ni_syscall)
+#define __NR_list_rt_threads_ex 285
+__SYSCALL(__NR_list_rt_threads_ex, sys_list_rt_threads_ex)
+#define __NR_rt_thread_watch 286
+__SYSCALL(__NR_rt_thread_watch, sys_rt_thread_watch)
+
 #undef __NR_syscalls
-#define __NR_syscalls 270
+#define __NR_syscalls 287
 
 /*
  * All syscalls below here should go away really,
@@ -49,6 +49,12 @@ SUBSYS(freezer)
 
 /* */
 
+#ifdef CONFIG_CGROUP_RTES
+SUBSYS(rtes)
+#endif
+
+/* */
+
 #ifdef CONFIG_NET_CLS_CGROUP
 SUBSYS(net_cls)
 #endif
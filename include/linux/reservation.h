@@ -7,8 +7,13 @@
 #include <linux/hrtimer.h>
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/irq_work.h>
+#include <linux/rtes.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
 
-#define MAX_PROCESSORS 4
+#define RTES_SPLIT_MAX_PARTS 4  // portions a split task is cut into at most
 #define MAX_TASKS 16
 
 enum partition_policy {
@@ -16,12 +21,59 @@ enum partition_policy {
     NF,     // Next Fit
     BF,     // Best Fit
     WF,      // Worst Fit
-    LST     // List Scheduling
+    LST,    // List Scheduling
+    CF      // Cluster Fit, first fit in the most loaded cluster
+};
+
+// How the reserved tasks of a cpu are scheduled and admitted
+enum reserve_sched_policy {
+    RTES_RM,    // fixed priorities, UB then RTA admission
+    RTES_EDF    // earliest absolute deadline first, U <= 1 admission
+};
+
+// rt priority shared by the reserved tasks in EDF mode, ordered by deadline within it
+#define RTES_EDF_PRIO 50
+
+// rt priority band of the reserved tasks in RM mode, assigned in period order
+#define RTES_RM_PRIO_MAX 90
+#define RTES_RM_PRIO_MIN 10
+
+// rt priority of split tasks, above the RM band
+#define RTES_SPLIT_PRIO (RTES_RM_PRIO_MAX + 1)
+
+// Budget portions of a task split across cpus, portion k runs on cpu[k] in window k of every job
+struct split_plan {
+    int parts;                                  // 0 when the task is not split
+    int cpu[RTES_SPLIT_MAX_PARTS];
+    struct timespec C[RTES_SPLIT_MAX_PARTS];
+    u64 window_ns;                              // D / number of windows
+};
+
+/**
+ * Budget shared by the threads of a group reservation, see group.c
+ * Admitted and accounted in the processor bucket as a single task with D = T.
+ */
+struct reserve_group {
+    int id;
+    struct timespec C;
+    struct timespec T;
+    struct timespec D;
+    int cpu;
+    spinlock_t lock;                    // members
+    struct list_head members;           // reservation_data.group_node
+    int nr_members;
+    atomic64_t exec_ns;                 // used by all members in the current period
+    bool throttled;                     // budget used up until the next period
+    struct hrtimer timer;               // replenishment
+    u64 period_count;
+    bool cgroup;                        // owned by an rtes cgroup, see rtes_cgroup.c
+    struct list_head node;              // in the list of groups
 };
 
 // Task structure for bin-packing
 struct bucket_task_ll {
-    struct task_struct *task;
+    struct task_struct *task;          // NULL for a group reservation
+    struct reserve_group *group;
     uint32_t util;
     struct timespec cost;
     struct timespec period;
@@ -36,6 +88,48 @@ struct bucket_info {
 };
 
 
+/**
+ * Log-linear (HDR style) histogram of microsecond values. Values below RTES_HIST_SUB get a bucket each,
+ * every power of two range above is split into RTES_HIST_SUB linear sub-buckets, so the relative error
+ * of a bucket is at most 1/RTES_HIST_SUB. 104 buckets cover up to 2^27 us (~134 s).
+ */
+#define RTES_HIST_SUB_BITS 2
+#define RTES_HIST_SUB (1 << RTES_HIST_SUB_BITS)
+#define RTES_HIST_BUCKETS 104
+
+struct rtes_hist {
+    u32 buckets[RTES_HIST_BUCKETS];
+    u64 count;
+    u64 sum_us;
+    u64 max_us;
+};
+
+// Per-job timing of a reservation, release = replenishment, completion = end_job
+struct job_stats {
+    spinlock_t lock;
+    u64 release_ns;                 // release time of the job in progress
+    u64 last_release_ns;            // most recent replenishment
+    bool job_active;                // released and not yet completed
+    bool job_missed;                // job in progress already counted as a miss
+    bool release_pending;           // released but not yet switched in
+    u64 jobs_released;
+    u64 jobs_completed;
+    u64 deadline_misses;
+    struct rtes_hist response_hist; // release -> end_job
+    struct rtes_hist release_hist;  // release -> first switch in
+};
+
+// Streaming statistics of the execution time per period
+struct exec_stats {
+    spinlock_t lock;
+    u64 samples;
+    s64 mean_ns;                    // Welford running mean
+    u64 m2_us;                      // Welford sum of squared deviations (us^2)
+    u64 min_ns;
+    u64 max_ns;
+    struct rtes_hist hist;
+};
+
 struct data_point {
     u64 timestamp;                  // Timestamp  which is actually period count 
 	char utilization[32];              // Utilization as a string
@@ -47,6 +141,11 @@ struct reservation_data {
     /* Reservation Framework parameters*/
 	struct timespec reserve_C;
 	struct timespec reserve_T;
+	struct timespec reserve_D;                  // relative deadline, D <= T
+	struct timespec reserve_offset;             // release offset given at admission
+	bool offset_pending;                        // suspended until the timer releases the first job
+	int reserve_cpu;                            // cpu the reservation was admitted on
+	enum reserve_type reserve_type;
 	struct hrtimer reservation_timer;
     struct hrtimer cost_timer;
     struct hrtimer period_timer;
@@ -59,7 +158,8 @@ struct reservation_data {
 	/* TaskMon parameters */
 	bool monitoring_enabled;
 	struct kobject *taskmon_kobj;				// kobject for taskmon represented as /sys
-	struct kobj_attribute *taskmon_tid_attr;
+	struct kobj_attribute taskmon_tid_attr;		// /sys/rtes/taskmon/util/<tid>, name NULL if not created
+	char taskmon_tid_name[12];
 	spinlock_t data_lock;						
 	struct list_head data_points;
 	u64 period_count;
@@ -68,6 +168,81 @@ struct reservation_data {
     u64 energy_accumulator;                     // Energy accumulator (mJ)
     struct kobject *energy_kobj;                // kobject for energy monitoring
 
+    /* Job tracking parameters */
+    struct kobject *task_kobj;                  // kobject for /sys/rtes/tasks/<pid>
+    struct job_stats jobs;
+    struct exec_stats exec;
+
+    /* Profile mode parameters */
+    bool profiling;                             // running unthrottled to estimate the budget
+    bool profile_done;                          // recommended_C is valid
+    unsigned int profile_periods_left;
+    int profile_cpuid;                          // cpuid used when the budget is applied
+    struct timespec recommended_C;
+    struct work_struct profile_work;
+
+    /* Adaptive reservation parameters */
+    bool adaptive;                              // budget adjusted by the per-cpu controller
+    struct timespec adapt_C_min;                // guaranteed budget
+    struct timespec adapt_C_max;
+    struct rtes_hist adapt_hist;                // execution times since the last controller step
+    u64 adapt_throttled;                        // periods since the last step that used the whole budget
+
+    /* Constant Bandwidth Server parameters */
+    u64 cbs_deadline_ns;                        // server deadline (ktime_get clock)
+    u64 cbs_used_ns;                            // budget consumed against the current deadline
+    bool cbs_throttled;                         // waiting for cbs_timer to get the budget back
+    struct hrtimer cbs_timer;
+
+    /* Semi-partitioned parameters */
+    struct split_plan split;
+    int split_idx;                              // portion of the current job
+    u64 split_base_ns;                          // exec_accumulated_time when the portion started
+    struct hrtimer split_timer;                 // window boundaries within the period
+    struct work_struct split_work;              // migrates a thread that is still queued
+
+    /* Bandwidth reclaiming parameters */
+    struct list_head reclaim_node;              // in the slack pool of reserve_cpu while donating
+    u64 reclaim_slack_ns;                       // budget left by the completed job
+    u64 reclaim_expires_ns;                     // deadline of the completed job (ktime_get clock)
+    unsigned int reclaim_prio;                  // rt priority when the slack was donated
+    u64 reclaimed_ns;                           // slack added to the budget of the current job
+    u64 reclaim_until_ns;                       // earliest deadline reclaimed_ns was taken from
+    u64 reclaimed_total_ns;
+    bool reclaim_throttled;                     // out of budget, waiting for slack or the next release
+
+    /* Overrun policy parameters */
+    int overrun_policy;                         // enum reserve_overrun_policy
+    struct sigqueue *overrun_sigq;              // preallocated SIGEXCESS, freed when the thread exits
+    struct irq_work overrun_irq_work;           // sends the signal or starts the demotion
+    struct work_struct overrun_work;            // demotes and promotes the thread
+    bool overrun_signalled;                     // overrun of the current job already handled
+    u64 overrun_ns;                             // by how much the budget was exceeded
+    u64 overrun_debt_ns;                        // borrowed by the last job from the current one
+    u64 overruns;
+    bool demoted;                               // SCHED_OTHER until the next release
+    bool demote_suspended;                      // suspended until overrun_work has demoted it
+    int demoted_policy;                         // policy and priority given back at the next release
+    unsigned int demoted_prio;
+
+    /* Blocking term parameters */
+    u64 block_declared_ns;                      // longest critical section, from set_reserve_blocking
+    u64 block_measured_ns;                      // longest wait of a reserved thread for a lock it held
+    bool block_reported;                        // measurement above the declared length reported
+    bool pi_borrowed;                           // ran past its budget while boosted, see blocking.c
+
+    /* Group reservation parameters */
+    struct reserve_group *group;                // budget shared with the other members, NULL if none
+    bool group_suspended;                       // waiting for the next period of the group
+    struct list_head group_node;
+
+    /* EDF and scheduling parameters */
+    bool edf;                                   // ordered by edf_deadline_ns in sched_rt
+    u64 edf_deadline_ns;                        // absolute deadline of the current job (ktime_get clock)
+    bool sched_saved;                           // orig_policy/orig_rt_priority are valid
+    int orig_policy;                            // restored when the reservation is cancelled
+    unsigned int orig_rt_priority;
+
 };
 
 // Function declarations
@@ -77,12 +252,140 @@ void cleanup_utilization_data(struct task_struct *task);
 void enable_monitoring_for_all_tasks(void);
 void disable_monitoring_for_all_tasks(void);
 int remove_tid_file(struct task_struct *task);
+ssize_t util_show(struct reservation_data *res_data, char *buf);
+
+// Function declarations for histograms and streaming statistics
+void hist_add(struct rtes_hist *hist, u64 value_ns);
+u64 hist_percentile(struct rtes_hist *hist, unsigned int permille);
+ssize_t hist_show(struct rtes_hist *hist, char *buf);
+void reset_exec_stats(struct reservation_data *res_data);
+void exec_stats_add(struct reservation_data *res_data, u64 exec_ns);
+ssize_t exec_stats_show(struct reservation_data *res_data, char *buf);
+
+// Function declarations for profile mode
+extern unsigned int profile_periods;
+extern unsigned int profile_percentile;
+extern unsigned int profile_margin;
+extern unsigned int profile_apply;
+void profile_work_fn(struct work_struct *work);
+
+// Function declarations for adaptive reservations
+extern unsigned int adapt_interval_ms;
+extern unsigned int adapt_percentile;
+extern unsigned int adapt_headroom;
+
+// Function declarations for CBS reservations
+void cbs_init(struct reservation_data *res_data);
+void cbs_start(struct reservation_data *res_data);
+void cbs_stop(struct reservation_data *res_data);
+void cbs_wakeup(struct reservation_data *res_data);
+bool cbs_charge(struct reservation_data *res_data, u64 delta_ns);
+
+// Function declarations for rt thread counts
+void rt_threads_account(struct task_struct *task, unsigned int old_prio, unsigned int new_prio);
+long nr_rt_threads(void);
+long nr_rt_threads_prio(unsigned int prio);
+unsigned int rt_threads_generation(void);
+void rt_watch_record(struct task_struct *task, unsigned int old_prio, unsigned int new_prio);
+struct pid_namespace;
+struct task_struct *rt_thread_next(struct pid_namespace *ns, pid_t *tid);
+
+// Function declarations for reservation events
+extern unsigned int event_interval_ms;
+void rtes_event(enum rtes_event_type type, struct task_struct *task, int cpu, u64 value);
+
+// Function declarations for blocking terms
+u64 blocking_cs_ns(struct reservation_data *res_data);
+struct task_struct *blocking_begin(struct task_struct *owner, u64 *start_ns);
+void blocking_end(struct task_struct *owner, u64 start_ns, int ret);
+bool blocking_extend(struct reservation_data *res_data, u64 budget_ns);
+
+// Function declarations for overrun policies
+void overrun_init(struct reservation_data *res_data);
+int overrun_set_policy(struct reservation_data *res_data, int policy);
+bool overrun_handle(struct reservation_data *res_data, u64 budget_ns);
+u64 overrun_admitted_ns(struct reservation_data *res_data);
+void overrun_release(struct reservation_data *res_data, u64 exec_ns);
+void overrun_stop(struct reservation_data *res_data);
+void overrun_exit(struct reservation_data *res_data);
+
+// Function declarations for group reservations
+struct reserve_group *reserve_group_create(struct timespec c, struct timespec t, int cpu);
+void reserve_group_free(struct reserve_group *group);
+struct reserve_group *reserve_group_find(int id);
+bool reserve_groups_exist(void);
+int reserve_group_params(int cpuid, struct timespec *c, struct timespec *t, struct timespec *d, int max);
+void reserve_group_add(struct reserve_group *group, struct reservation_data *res_data);
+void reserve_group_del(struct reservation_data *res_data);
+bool reserve_group_charge(struct reserve_group *group, u64 delta_ns);
+void reserve_group_exit(struct task_struct *task);
+long do_create_reserve_group(struct timespec c, struct timespec t, int cpuid, bool cgroup);
+long do_join_reserve_group(struct task_struct *task, int id, bool cgroup);
+void do_leave_reserve_group(struct task_struct *task, bool cgroup);
+long do_destroy_reserve_group(int id, bool cgroup);
+int reserve_group_info(int id, struct reserve_group *info);
+
+// Function declarations for EDF scheduling
+extern enum reserve_sched_policy current_sched_policy;
+void rtes_edf_set_deadline(struct task_struct *p, u64 deadline_ns);
+extern unsigned int assign_priorities;
+
+// Function declarations for overhead-aware admission
+extern unsigned int overhead_aware;
+void overhead_timer(u64 start_ns);
+void overhead_switch_begin(bool reserved);
+void overhead_switch_end(void);
+u64 overhead_job_ns(int cpuid);
+
+// Function declarations for semi-partitioned reservations
+extern unsigned int semi_partitioned;
+int check_portion_schedulability(int cpuid, struct timespec c, struct timespec t, struct timespec w);
+int find_split(struct timespec c, struct timespec t, struct timespec d, struct split_plan *plan);
+void split_init(struct reservation_data *res_data);
+void split_start(struct reservation_data *res_data, u64 release_ns);
+void split_release(struct reservation_data *res_data, u64 release_ns);
+void split_stop(struct reservation_data *res_data);
+u64 split_budget_ns(struct reservation_data *res_data);
+int rtes_move_sleeping_task(struct task_struct *p, int cpu);
+
+// Function declarations for bandwidth reclaiming
+extern unsigned int reclaiming;
+void reclaim_init(struct reservation_data *res_data);
+void reclaim_donate(struct reservation_data *res_data);
+bool reclaim_extend(struct reservation_data *res_data, u64 budget_ns);
+void reclaim_throttle(struct reservation_data *res_data);
+void reclaim_release(struct reservation_data *res_data);
+void reclaim_stop(struct reservation_data *res_data);
+
+// Function declarations for job tracking
+void reset_job_stats(struct reservation_data *res_data);
+void job_release(struct reservation_data *res_data, u64 release_ns, bool running);
+void job_switch_in(struct reservation_data *res_data);
+void job_complete(struct reservation_data *res_data);
+int create_task_dir(struct task_struct *task);
+void remove_task_dir(struct task_struct *task);
+
+
+// Function declarations for the registry of reserved threads
+struct reserved_task {
+    struct task_struct *task;
+    struct list_head list;      // in reserved_tasks_list
+    struct rcu_head rcu;
+};
+extern struct list_head reserved_tasks_list;
 
+// Whether cpu can hold partitioned reservations
+static inline bool rtes_cpu_valid(int cpu)
+{
+    return cpu >= 0 && cpu < nr_cpu_ids && cpu_possible(cpu);
+}
 
 // Function declarations for bin packing
 extern enum partition_policy current_policy;
-extern struct bucket_info processors[MAX_PROCESSORS];
-int find_best_processor(uint32_t util, enum partition_policy policy, struct timespec C, struct timespec T);
+DECLARE_PER_CPU(struct bucket_info, rtes_buckets);
+#define rtes_bucket(cpu) (&per_cpu(rtes_buckets, (cpu)))
+extern spinlock_t processors_lock;
+int find_best_processor(uint32_t util, enum partition_policy policy, struct timespec C, struct timespec T, struct timespec D);
 void add_task_to_processor(struct task_struct *task, struct timespec C, struct timespec T, int cpuid);
 void remove_task_from_processor(struct task_struct *task);
 void remove_task_from_list(struct task_struct *task);
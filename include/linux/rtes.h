@@ -0,0 +1,184 @@
+#ifndef _LINUX_RTES_H
+#define _LINUX_RTES_H
+
+/**
+ * Userspace interface of the rtes reservation framework
+ *  Syscall numbers, and the structures and constants the syscalls, /proc/rtes and the RTES_EVENTS netlink
+ *  family exchange with userspace. Exported with make headers_install, tools include it instead of
+ *  declaring their own copies:
+ *      #include <time.h>
+ *      #include <unistd.h>
+ *      #include <sys/syscall.h>
+ *      #include <linux/rtes.h>
+ *      syscall(__NR_set_reserve, tid, &C, &T, cpuid);
+ *
+ *  The numbers come from asm/unistd.h of the architecture. When the libc headers of a toolchain shadow the
+ *  exported asm/unistd.h, the fallbacks below give the same numbers for arm, x86_64, i386 and the
+ *  asm-generic architectures; they follow the order of the syscall tables and have to be kept in sync.
+ *
+ *  32-bit programs on an x86_64 kernel can only use the calls without struct timespec arguments, the
+ *  others return -ENOSYS there.
+ */
+
+#include <linux/types.h>
+#include <asm/unistd.h>
+#ifdef __KERNEL__
+#include <linux/time.h>
+#else
+#include <time.h>
+#endif
+
+#if !defined(__KERNEL__) && !defined(__NR_calc)
+#if defined(__arm__)
+#define __RTES_NR_BASE (__NR_SYSCALL_BASE + 376)
+#elif defined(__x86_64__)
+#define __RTES_NR_BASE 310
+#elif defined(__i386__)
+#define __RTES_NR_BASE 347
+#else
+#define __RTES_NR_BASE 270      // asm-generic/unistd.h
+#endif
+#define __NR_calc                   (__RTES_NR_BASE + 0)
+#define __NR_count_rt_threads       (__RTES_NR_BASE + 1)
+#define __NR_list_rt_threads        (__RTES_NR_BASE + 2)
+#define __NR_set_reserve            (__RTES_NR_BASE + 3)
+#define __NR_cancel_reserve         (__RTES_NR_BASE + 4)
+#define __NR_end_job                (__RTES_NR_BASE + 5)
+#define __NR_profile_reserve        (__RTES_NR_BASE + 6)
+#define __NR_set_reserve_adaptive   (__RTES_NR_BASE + 7)
+#define __NR_set_reserve_type       (__RTES_NR_BASE + 8)
+#define __NR_set_reserve_ex         (__RTES_NR_BASE + 9)
+#define __NR_set_overrun_policy     (__RTES_NR_BASE + 10)
+#define __NR_create_reserve_group   (__RTES_NR_BASE + 11)
+#define __NR_join_reserve_group     (__RTES_NR_BASE + 12)
+#define __NR_destroy_reserve_group  (__RTES_NR_BASE + 13)
+#define __NR_set_reserve_blocking   (__RTES_NR_BASE + 14)
+#define __NR_list_rt_threads_ex     (__RTES_NR_BASE + 15)
+#define __NR_rt_thread_watch        (__RTES_NR_BASE + 16)
+#endif
+
+// Budget overrun signal, defined by the arm and asm-generic signal.h
+#ifndef SIGEXCESS
+#define SIGEXCESS 33
+#endif
+
+#define RTES_GLOBAL_CPU (-2)    // cpuid of reservations scheduled globally on all cpus
+
+// How the budget of a reservation is replenished
+enum reserve_type {
+    RESERVE_PERIODIC,   // C at every period boundary of the replenishment timer
+    RESERVE_CBS,        // Constant Bandwidth Server, see cbs.c
+    RESERVE_TYPE_MAX
+};
+
+// What happens when a periodic reservation uses up its budget, see overrun.c
+enum reserve_overrun_policy {
+    RTES_OVERRUN_THROTTLE,  // suspended until the next release
+    RTES_OVERRUN_SIGNAL,    // suspended, and SIGEXCESS with the overrun in ns
+    RTES_OVERRUN_DEMOTE,    // SCHED_OTHER until the next release
+    RTES_OVERRUN_BORROW,    // up to C more, taken from the next job
+    RTES_OVERRUN_MAX
+};
+
+// Parameters of set_reserve_ex
+struct reserve_attr {
+    struct timespec C;          // budget
+    struct timespec T;          // period
+    struct timespec D;          // relative deadline, 0 < D <= T, 0 for D = T
+    struct timespec offset;     // release of the first job after the call, 0 <= offset < T
+    int type;                   // enum reserve_type
+};
+
+// An rt thread as listed by list_rt_threads, see ps.c
+struct rt_thread {
+    __kernel_pid_t tid;
+    __kernel_pid_t pid;
+    int priority;               // rt_priority
+    char name[20];              // command
+};
+
+// An rt thread as listed by list_rt_threads_ex, see ps.c
+struct rt_thread_info {
+    __kernel_pid_t tid;
+    __kernel_pid_t pid;
+    int priority;               // rt_priority
+    int policy;                 // SCHED_FIFO, SCHED_RR, ...
+    int cpu;                    // cpu it last ran on
+    int reserved;               // has a reservation
+    int reserve_cpu;            // cpu of the reservation, -1 for none, RTES_GLOBAL_CPU for global
+    unsigned int C_us;          // budget and period of the reservation
+    unsigned int T_us;
+    char name[16];              // command
+};
+
+// Position of a paginated listing, see list_rt_threads_ex
+struct rt_list_cursor {
+    __kernel_pid_t next_tid;             // in: first tid to list, 0 from the start; out: tid to resume from, 0 at the end
+    unsigned int generation;    // out: changes whenever a thread enters or leaves the rt class or changes priority
+};
+
+// A change of the rt threads as read from rt_thread_watch, see rtwatch.c
+struct rt_thread_event {
+    __kernel_pid_t tid;                  // 0 if changes were lost and the threads have to be listed again
+    unsigned int old_prio;      // rt priority before, 0 if it was not an rt thread
+    unsigned int new_prio;      // rt priority after, 0 if it left the rt class or exited
+    unsigned int seq;           // sequence number of the change
+};
+
+// Reservation events multicast over generic netlink, see events.c
+#define RTES_EVENTS_GENL_NAME "RTES_EVENTS"
+#define RTES_EVENTS_GENL_VERSION 1
+#define RTES_EVENTS_MCGRP_NAME "events"
+#define RTES_EVENT_BATCH 64         // events a cpu sends per event_interval_ms at most
+
+enum rtes_events_cmd {
+    RTES_EVENTS_CMD_UNSPEC,
+    RTES_EVENTS_CMD_EVENTS,
+};
+
+enum rtes_events_attr {
+    RTES_EVENTS_A_UNSPEC,
+    RTES_EVENTS_A_CPU,          // u32
+    RTES_EVENTS_A_DROPPED,      // u32
+    RTES_EVENTS_A_EVENTS,       // struct rtes_event[]
+    __RTES_EVENTS_A_MAX,
+};
+#define RTES_EVENTS_A_MAX (__RTES_EVENTS_A_MAX - 1)
+
+enum rtes_event_type {
+    RTES_EVENT_ADMIT,
+    RTES_EVENT_REJECT,
+    RTES_EVENT_CANCEL,
+    RTES_EVENT_EXIT,
+    RTES_EVENT_THROTTLE,
+    RTES_EVENT_REPLENISH,
+    RTES_EVENT_OVERRUN,
+};
+
+struct rtes_event {
+    __u64 time_ns;              // CLOCK_MONOTONIC
+    __u64 value;                // depends on type
+    __s32 tid;
+    __u16 type;                 // enum rtes_event_type
+    __s16 cpu;                  // cpu of the reservation, -1 if none
+};
+
+// Reservation of a thread as read from /proc/rtes/reserves_bin, see procfs.c
+struct rtes_reserve_info {
+    __s32 tid;
+    __s32 pid;
+    __u32 priority;             // rt priority
+    __s32 cpu;                  // cpu of the reservation, RTES_GLOBAL_CPU for global
+    __u64 C_ns;
+    __u64 T_ns;
+    __u64 D_ns;
+    __u64 used_ns;              // budget used in the current period
+    __u64 overruns;
+    __u64 energy_mj;
+    __u32 util;                 // C / T in permille
+    __u16 type;                 // enum reserve_type
+    __u16 overrun_policy;       // enum reserve_overrun_policy
+    char name[16];              // command
+};
+
+#endif /* _LINUX_RTES_H */
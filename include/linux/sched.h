@@ -1240,6 +1240,7 @@ struct task_struct {
 
 	/* Reservation Framework parameters*/
 	struct reservation_data *reservation_data;
+	bool rt_accounted;	/* in the rt thread counts, under pi_lock */
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
@@ -50,6 +50,7 @@ struct statfs64;
 struct __sysctl_args;
 struct sysinfo;
 struct timespec;
+struct reserve_attr;
 struct timeval;
 struct timex;
 struct timezone;
@@ -64,6 +65,8 @@ struct old_linux_dirent;
 struct perf_event_attr;
 struct file_handle;
 struct rt_thread;
+struct rt_thread_info;
+struct rt_list_cursor;
 
 #include <linux/types.h>
 #include <linux/aio_abi.h>
@@ -853,4 +856,18 @@ asmlinkage long sys_list_rt_threads(struct rt_thread __user *rt_thread, unsigned
 asmlinkage long sys_set_reserve(pid_t tid, struct timespec __user *C, struct timespec __user *T, int cpuid);
 asmlinkage long sys_cancel_reserve(pid_t tid);
 asmlinkage long sys_end_job(void);
+asmlinkage long sys_set_reserve_type(pid_t tid, struct timespec __user *C, struct timespec __user *T, int cpuid,
+                                     int type);
+asmlinkage long sys_set_reserve_ex(pid_t tid, struct reserve_attr __user *attr, int cpuid);
+asmlinkage long sys_set_overrun_policy(pid_t tid, int policy);
+asmlinkage long sys_create_reserve_group(struct timespec __user *C, struct timespec __user *T, int cpuid);
+asmlinkage long sys_join_reserve_group(pid_t tid, int id);
+asmlinkage long sys_destroy_reserve_group(int id);
+asmlinkage long sys_set_reserve_blocking(pid_t tid, struct timespec __user *cs);
+asmlinkage long sys_list_rt_threads_ex(struct rt_thread_info __user *list, unsigned int n,
+                                       struct rt_list_cursor __user *cursor);
+asmlinkage long sys_rt_thread_watch(int flags);
+asmlinkage long sys_profile_reserve(pid_t tid, struct timespec __user *T, int cpuid);
+asmlinkage long sys_set_reserve_adaptive(pid_t tid, struct timespec __user *Cmin, struct timespec __user *Cmax,
+                                         struct timespec __user *T, int cpuid);
 #endif
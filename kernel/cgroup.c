@@ -4117,7 +4117,7 @@ static void __init cgroup_init_subsys(struct cgroup_subsys *ss)
 	 * init_css_set is in the subsystem's top cgroup. */
 	init_css_set.subsys[ss->subsys_id] = dummytop->subsys[ss->subsys_id];
 
-	need_forkexit_callback |= ss->fork || ss->exit;
+	need_forkexit_callback |= ss->fork || ss->post_fork || ss->exit;
 
 	/* At system boot, before all subsystems have been
 	 * registered, no tasks have been forked, so we don't
@@ -4158,7 +4158,7 @@ int __init_or_module cgroup_load_subsys(struct cgroup_subsys *ss)
 	 * be a module should still have no callbacks even if the user isn't
 	 * compiling it as one.
 	 */
-	if (ss->fork || ss->exit)
+	if (ss->fork || ss->post_fork || ss->exit)
 		return -EINVAL;
 
 	/*
@@ -4600,6 +4600,19 @@ void cgroup_post_fork(struct task_struct *child)
 		task_unlock(child);
 		write_unlock(&css_set_lock);
 	}
+
+	/*
+	 * Unlike fork callbacks, post_fork callbacks see a task that is
+	 * hashed and can be found and attached, and may sleep.
+	 */
+	if (need_forkexit_callback) {
+		int i;
+		for (i = 0; i < CGROUP_BUILTIN_SUBSYS_COUNT; i++) {
+			struct cgroup_subsys *ss = subsys[i];
+			if (ss->post_fork)
+				ss->post_fork(ss, child);
+		}
+	}
 }
 /**
  * cgroup_exit - detach cgroup from exiting task
@@ -63,7 +63,13 @@ static void exit_mm(struct task_struct * tsk);
 static void __unhash_process(struct task_struct *p, bool group_dead)
 {
 	nr_threads--;
+	/* Uncounted with the pid, pi_lock keeps __setscheduler out meanwhile */
+	raw_spin_lock(&p->pi_lock);
+	if (p->rt_accounted)
+		rt_threads_account(p, p->rt_priority, 0);
+	p->rt_accounted = false;
 	detach_pid(p, PIDTYPE_PID);
+	raw_spin_unlock(&p->pi_lock);
 	if (group_dead) {
 		detach_pid(p, PIDTYPE_PGID);
 		detach_pid(p, PIDTYPE_SID);
@@ -985,27 +991,47 @@ NORET_TYPE void do_exit(long code)
 	exit_files(tsk);
 	exit_fs(tsk);
 	// for reservation framework
+	task_lock(tsk);		/* PF_EXITING is set, a group join is done or fails */
+	task_unlock(tsk);
 	if (tsk->reservation_data && tsk->reservation_data->has_reservation) {
 		struct reservation_data *res_data = tsk->reservation_data;
 		printk(KERN_INFO "Task %d exiting with active reservation. Cleaning up...\n", tsk->pid);
+		rtes_event(RTES_EVENT_EXIT, tsk, res_data->reserve_cpu, 0);
 
 		// Cancel the high-resolution timer associated with the reservation
 		hrtimer_cancel(&res_data->reservation_timer);
+		cancel_work_sync(&res_data->profile_work);
+		cbs_stop(res_data);
+		split_stop(res_data);
+		reclaim_stop(res_data);
+		overrun_stop(res_data);
+		res_data->edf = false;
 
 		// Reset reservation parameters
 		memset(&res_data->reserve_C, 0, sizeof(struct timespec));
 		memset(&res_data->reserve_T, 0, sizeof(struct timespec));
 
 		// Remove task from processor, reserved task list, and clean sysfs entries
-		remove_task_from_processor(tsk);
-		remove_task_from_list(tsk);
+		if (res_data->group) {
+			reserve_group_exit(tsk);
+		} else if (!res_data->profiling) {
+			if (res_data->reserve_cpu != RTES_GLOBAL_CPU)
+				remove_task_from_processor(tsk);
+			remove_task_from_list(tsk);
+		}
+		res_data->split.parts = 0;
+		res_data->profiling = false;
+		res_data->adaptive = false;
 		remove_tid_file(tsk);
+		remove_task_dir(tsk);
 		cleanup_utilization_data(tsk);
 
 		res_data->has_reservation = false;
 
 		printk(KERN_INFO "Cleanup for task %d completed.\n", tsk->pid);
 	}
+	if (tsk->reservation_data)
+		overrun_exit(tsk->reservation_data);
 
 	check_stack_usage();
 	exit_thread();
@@ -66,6 +66,7 @@
 #include <linux/user-return-notifier.h>
 #include <linux/oom.h>
 #include <linux/khugepaged.h>
+#include <linux/reservation.h>
 
 #include <asm/pgtable.h>
 #include <asm/pgalloc.h>
@@ -1152,6 +1153,8 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	INIT_LIST_HEAD(&p->sibling);
 	rcu_copy_process(p);
 	p->vfork_done = NULL;
+	p->reservation_data = NULL;	/* reservations are per thread, not inherited */
+	p->rt_accounted = false;	/* counted when its pid is attached */
 	spin_lock_init(&p->alloc_lock);
 
 	init_sigpending(&p->pending);
@@ -1384,6 +1387,14 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 			list_add_tail_rcu(&p->tasks, &init_task.tasks);
 			__this_cpu_inc(process_counts);
 		}
+		/*
+		 * Counted with the pid, until then __setscheduler leaves the
+		 * counts alone since p still has the pids of its parent
+		 */
+		raw_spin_lock(&p->pi_lock);
+		rt_threads_account(p, 0, p->rt_priority);
+		p->rt_accounted = true;
+		raw_spin_unlock(&p->pi_lock);
 		attach_pid(p, PIDTYPE_PID, pid);
 		nr_threads++;
 	}
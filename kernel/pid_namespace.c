@@ -143,6 +143,7 @@ void free_pid_ns(struct kref *kref)
 	if (parent != NULL)
 		put_pid_ns(parent);
 }
+EXPORT_SYMBOL_GPL(free_pid_ns);	/* put_pid_ns() from modules */
 
 void zap_pid_ns_processes(struct pid_namespace *pid_ns)
 {
@@ -3,9 +3,9 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 #include <string.h>
+#include <linux/rtes.h>
 
 #define BUFFER_SIZE 32
-#define __NR_calc 376
 
 /**
  * 4.5.2 Write a calculator application (5 points)
@@ -27,10 +27,7 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
-
-#define SIGEXCESS 33
-#define _NR_end_job 381
-#define _NR_set_reserve 379
+#include <linux/rtes.h>
 
 int parse_cmd_args(int argc, char *argv[], int32_t *C, int32_t *T, int32_t *cpuid)
 {
@@ -103,7 +100,7 @@ void sigtstp_handler(int sig)
 {
     // Ctrl+z signal
     printf("SIGTSTP: end_job()\n");
-    int ret = syscall(_NR_end_job);
+    int ret = syscall(__NR_end_job);
     if (ret < 0)
     {   
         if (ret == -2) {
@@ -136,7 +133,7 @@ int main(int argc, char *argv[])
     // Register signal handlers
     signal(SIGEXCESS, sigexcess_handler);
 
-    if (syscall(_NR_set_reserve, 0, &cost, &period, cpuid) < 0) {
+    if (syscall(__NR_set_reserve, 0, &cost, &period, cpuid) < 0) {
         perror("Failed to set reservation");
         exit(1);
     }
@@ -168,7 +165,7 @@ int main(int argc, char *argv[])
         // Periodic task is suspended for T - C ms //////////////////
         // usleep: suspend execution for microsecond intervals
         usleep((T /*ms*/ - C /*ms*/) * 1000 /*us*/); // ms to us
-        // if (syscall(_NR_end_job) < 0) {
+        // if (syscall(__NR_end_job) < 0) {
         //     perror("end_job failed");
         //     exit(1);
         // }
@@ -6,13 +6,52 @@
  *
  * | command | command-specific arguments                    |
  * |---------|-----------------------------------------------|
- * | set     | budget C in ms, period T in ms, a CPU core ID |
+ * | set     | budget C in ms, period T in ms, a CPU core ID, optionally "cbs" |
  * | cancel  | none                                          |
+ * | profile | period T in ms, a CPU core ID (-1 for any)    |
+ * | adaptive| Cmin in ms, Cmax in ms, period T in ms, a CPU core ID |
+ * | setex   | budget C, period T, deadline D, release offset in ms, a CPU core ID |
+ * | overrun | throttle, signal, demote or borrow            |
+ * | group   | budget C in ms, period T in ms, a CPU core ID (-1 for any), prints the group ID |
+ * | join    | a group ID                                    |
+ * | ungroup | a group ID, destroys the group (tid ignored, use 0) |
+ * | blocking| longest critical section in ms on a PI futex shared with other reserved threads |
  *
  * For example, to set and then to cancel a reserve with a budget of 250 ms and a
  * period of 500 ms on thread with ID 101:
  *     $ ./reserve set 101 250 500 0
  *     $ ./reserve cancel 101
+ *
+ * To give an event-driven thread 101 a Constant Bandwidth Server of 10 ms every 100 ms instead:
+ *     $ ./reserve set 101 10 100 0 cbs
+ *
+ * To require thread 101 to finish 20 ms into each 100 ms period, first released 5 ms from now:
+ *     $ ./reserve setex 101 10 100 20 5 0
+ *
+ * To let thread 101 run unthrottled with a period of 500 ms until the kernel proposes a budget
+ * (see /sys/rtes/tasks/101/profile and /sys/rtes/config/profile_*):
+ *     $ ./reserve profile 101 500 0
+ *
+ * To guarantee thread 101 a budget of 100 ms every 500 ms and let the kernel grow it up to 300 ms
+ * when the thread needs it (see /sys/rtes/config/adapt_*):
+ *     $ ./reserve adaptive 101 100 300 500 0
+ *
+ * A CPU core ID of -1 lets the kernel pick the core, -2 schedules the thread globally on all cores
+ * (RM scheduling policy only, not mixed with per-core reservations):
+ *     $ ./reserve set 101 250 500 -2
+ *
+ * To have thread 101 receive SIGEXCESS with the overrun in ns when it exceeds its budget, after setting it:
+ *     $ ./reserve overrun 101 signal
+ *
+ * To share a budget of 30 ms every 100 ms between threads 101 and 102 (the group gets ID 1), then drop it:
+ *     $ ./reserve group 0 30 100 -1
+ *     $ ./reserve join 101 1
+ *     $ ./reserve join 102 1
+ *     $ ./reserve ungroup 0 1
+ *
+ * To declare that reserved thread 101 holds a PI futex it shares with other reserved threads of its
+ * core for at most 2 ms, so that their admission accounts for the blocking:
+ *     $ ./reserve blocking 101 2
  */
 
 #include <stdio.h>
@@ -23,22 +62,16 @@
 #include <linux/unistd.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <linux/rtes.h>
 
 #define MS_IN_NS 1000000
-#define __NR_set_reserve 379
-#define __NR_cancel_reserve 380
-#define __NR_list_rt_threads 378
 #define MAX_THREADS 200
 
-struct rt_thread
-{
-    pid_t tid;    /* Thread ID */
-    pid_t pid;    /* Process ID */
-    int priority; /* Thread Priority */
-    char name[20];   /* Name (command) */
-};
+// Overrun policies, in the order of enum reserve_overrun_policy
+static const char *overrun_policies[] = {"throttle", "signal", "demote", "borrow"};
 
-int parse_cmd_args(int argc, char *argv[], char **cmd, int32_t *tid, int32_t *C, int32_t *T, int32_t *cpuid)
+int parse_cmd_args(int argc, char *argv[], char **cmd, int32_t *tid, int32_t *C, int32_t *Cmax, int32_t *T, int32_t *cpuid, int32_t *type,
+                   int32_t *D, int32_t *offset, int32_t *policy)
 {
     // Parse and check command line arguments
 
@@ -47,15 +80,16 @@ int parse_cmd_args(int argc, char *argv[], char **cmd, int32_t *tid, int32_t *C,
     if (strcmp(*cmd, "set") == 0)
     {
         // Check if the number of arguments is correct
-        if (argc != 6)
+        if (argc != 6 && !(argc == 7 && strncmp(argv[6], "cbs", 3) == 0))
         {
-            printf("Usage: %s set <tid> <C> <T> <cpuid>\n", argv[0]);
+            printf("Usage: %s set <tid> <C> <T> <cpuid> [cbs]\n", argv[0]);
             return -1; // Return error
         }
         *tid = atoi(argv[2]);
         *C = atoi(argv[3]);
         *T = atoi(argv[4]);
         *cpuid = atoi(argv[5]);
+        *type = (argc == 7) ? RESERVE_CBS : RESERVE_PERIODIC;
     }
     else if (strcmp(*cmd, "cancel") == 0)
     {
@@ -67,6 +101,102 @@ int parse_cmd_args(int argc, char *argv[], char **cmd, int32_t *tid, int32_t *C,
         }
         *tid = atoi(argv[2]);
     }
+    else if (strcmp(*cmd, "profile") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 5)
+        {
+            printf("Usage: %s profile <tid> <T> <cpuid>\n", argv[0]);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        *T = atoi(argv[3]);
+        *cpuid = atoi(argv[4]);
+    }
+    else if (strcmp(*cmd, "adaptive") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 7)
+        {
+            printf("Usage: %s adaptive <tid> <Cmin> <Cmax> <T> <cpuid>\n", argv[0]);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        *C = atoi(argv[3]);
+        *Cmax = atoi(argv[4]);
+        *T = atoi(argv[5]);
+        *cpuid = atoi(argv[6]);
+    }
+    else if (strcmp(*cmd, "setex") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 8)
+        {
+            printf("Usage: %s setex <tid> <C> <T> <D> <offset> <cpuid>\n", argv[0]);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        *C = atoi(argv[3]);
+        *T = atoi(argv[4]);
+        *D = atoi(argv[5]);
+        *offset = atoi(argv[6]);
+        *cpuid = atoi(argv[7]);
+    }
+    else if (strcmp(*cmd, "overrun") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 4)
+        {
+            printf("Usage: %s overrun <tid> <throttle|signal|demote|borrow>\n", argv[0]);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        for (*policy = 0; *policy < 4; (*policy)++)
+        {
+            if (strcmp(argv[3], overrun_policies[*policy]) == 0)
+                break;
+        }
+        if (*policy == 4)
+        {
+            printf("%s is not a valid overrun policy\n", argv[3]);
+            return -1;
+        }
+    }
+    else if (strcmp(*cmd, "group") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 6)
+        {
+            printf("Usage: %s group 0 <C> <T> <cpuid>\n", argv[0]);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        *C = atoi(argv[3]);
+        *T = atoi(argv[4]);
+        *cpuid = atoi(argv[5]);
+    }
+    else if (strcmp(*cmd, "join") == 0 || strcmp(*cmd, "ungroup") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 4)
+        {
+            printf("Usage: %s %s <tid> <group id>\n", argv[0], *cmd);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        *cpuid = atoi(argv[3]); // group id
+    }
+    else if (strcmp(*cmd, "blocking") == 0)
+    {
+        // Check if the number of arguments is correct
+        if (argc != 4)
+        {
+            printf("Usage: %s blocking <tid> <cs>\n", argv[0]);
+            return -1; // Return error
+        }
+        *tid = atoi(argv[2]);
+        *C = atoi(argv[3]);
+    }
     else if (strcmp(*cmd, "list") == 0)
     {
         // Check if the number of arguments is correct
@@ -79,7 +209,7 @@ int parse_cmd_args(int argc, char *argv[], char **cmd, int32_t *tid, int32_t *C,
     else
     {
         printf("%s is not a valid command\n", *cmd);
-        printf("Valid commands: set, cancel, list\n");
+        printf("Valid commands: set, setex, cancel, profile, adaptive, overrun, group, join, ungroup, blocking, list\n");
         return -1;
     }
 
@@ -110,8 +240,9 @@ void print_threads(struct rt_thread *list, int loop_len)
 int main(int argc, char *argv[])
 {
     char *cmd;
-    int32_t tid, C, T, cpuid, num_to_disp;
-    struct timespec C_ts, T_ts;
+    int32_t tid, C, Cmax, T, D, offset, cpuid, type = RESERVE_PERIODIC, policy, num_to_disp;
+    struct timespec C_ts, Cmax_ts, T_ts;
+    struct reserve_attr attr;
     struct rt_thread rt_threads_list[MAX_THREADS]; // use stack memory
 
 
@@ -152,7 +283,7 @@ int main(int argc, char *argv[])
         argc = i;
     }
 
-    if (parse_cmd_args(argc, argv, &cmd, &tid, &C, &T, &cpuid) != 0)
+    if (parse_cmd_args(argc, argv, &cmd, &tid, &C, &Cmax, &T, &cpuid, &type, &D, &offset, &policy) != 0)
     {
         return -1; // Return error
     }
@@ -171,12 +302,134 @@ int main(int argc, char *argv[])
 
         // TODO: replace with syscalls
         printf("set_reserve(tid=%d, C=%ld.%09ld, T=%ld.%09ld, cpuid=%d)\n", tid, C_ts.tv_sec, C_ts.tv_nsec, T_ts.tv_sec, T_ts.tv_nsec, cpuid);
-        if (syscall(__NR_set_reserve, tid, &C_ts, &T_ts, cpuid) < 0)
+        if (type == RESERVE_CBS)
+        {
+            // int set_reserve_type(pid t tid, struct timespec *C, struct timespec *T, int cpuid, int type);
+            if (syscall(__NR_set_reserve_type, tid, &C_ts, &T_ts, cpuid, type) < 0)
+            {
+                perror("set_reserve_type");
+                return -1; // Return error
+            }
+        }
+        else if (syscall(__NR_set_reserve, tid, &C_ts, &T_ts, cpuid) < 0)
         {
             perror("set_reserve");
             return -1; // Return error
         }
     }
+    else if (strcmp(cmd, "profile") == 0)
+    {
+        // int profile_reserve(pid t tid, struct timespec *T, int cpuid);
+        T_ts.tv_sec = T / 1000;               // ms -> s
+        T_ts.tv_nsec = (T % 1000) * MS_IN_NS; // ms -> ns
+
+        printf("profile_reserve(tid=%d, T=%ld.%09ld, cpuid=%d)\n", tid, T_ts.tv_sec, T_ts.tv_nsec, cpuid);
+        if (syscall(__NR_profile_reserve, tid, &T_ts, cpuid) < 0)
+        {
+            perror("profile_reserve");
+            return -1; // Return error
+        }
+    }
+    else if (strcmp(cmd, "setex") == 0)
+    {
+        // int set_reserve_ex(pid t tid, struct reserve_attr *attr, int cpuid);
+        memset(&attr, 0, sizeof(attr));
+        attr.C.tv_sec = C / 1000;                       // ms -> s
+        attr.C.tv_nsec = (C % 1000) * MS_IN_NS;         // ms -> ns
+        attr.T.tv_sec = T / 1000;
+        attr.T.tv_nsec = (T % 1000) * MS_IN_NS;
+        attr.D.tv_sec = D / 1000;
+        attr.D.tv_nsec = (D % 1000) * MS_IN_NS;
+        attr.offset.tv_sec = offset / 1000;
+        attr.offset.tv_nsec = (offset % 1000) * MS_IN_NS;
+        attr.type = RESERVE_PERIODIC;
+
+        printf("set_reserve_ex(tid=%d, C=%dms, T=%dms, D=%dms, offset=%dms, cpuid=%d)\n", tid, C, T, D, offset, cpuid);
+        if (syscall(__NR_set_reserve_ex, tid, &attr, cpuid) < 0)
+        {
+            perror("set_reserve_ex");
+            return -1; // Return error
+        }
+    }
+    else if (strcmp(cmd, "adaptive") == 0)
+    {
+        // int set_reserve_adaptive(pid t tid, struct timespec *Cmin, struct timespec *Cmax, struct timespec *T, int cpuid);
+        C_ts.tv_sec = C / 1000;                     // ms -> s
+        C_ts.tv_nsec = (C % 1000) * MS_IN_NS;       // ms -> ns
+
+        Cmax_ts.tv_sec = Cmax / 1000;               // ms -> s
+        Cmax_ts.tv_nsec = (Cmax % 1000) * MS_IN_NS; // ms -> ns
+
+        T_ts.tv_sec = T / 1000;                     // ms -> s
+        T_ts.tv_nsec = (T % 1000) * MS_IN_NS;       // ms -> ns
+
+        printf("set_reserve_adaptive(tid=%d, Cmin=%ld.%09ld, Cmax=%ld.%09ld, T=%ld.%09ld, cpuid=%d)\n", tid,
+               C_ts.tv_sec, C_ts.tv_nsec, Cmax_ts.tv_sec, Cmax_ts.tv_nsec, T_ts.tv_sec, T_ts.tv_nsec, cpuid);
+        if (syscall(__NR_set_reserve_adaptive, tid, &C_ts, &Cmax_ts, &T_ts, cpuid) < 0)
+        {
+            perror("set_reserve_adaptive");
+            return -1; // Return error
+        }
+    }
+    else if (strcmp(cmd, "overrun") == 0)
+    {
+        // int set_overrun_policy(pid t tid, int policy);
+        printf("set_overrun_policy(tid=%d, policy=%s)\n", tid, overrun_policies[policy]);
+        if (syscall(__NR_set_overrun_policy, tid, policy) < 0)
+        {
+            perror("set_overrun_policy");
+            return -1; // Return error
+        }
+    }
+    else if (strcmp(cmd, "group") == 0)
+    {
+        // int create_reserve_group(struct timespec *C, struct timespec *T, int cpuid);
+        C_ts.tv_sec = C / 1000;               // ms -> s
+        C_ts.tv_nsec = (C % 1000) * MS_IN_NS; // ms -> ns
+
+        T_ts.tv_sec = T / 1000;               // ms -> s
+        T_ts.tv_nsec = (T % 1000) * MS_IN_NS; // ms -> ns
+
+        if ((num_to_disp = syscall(__NR_create_reserve_group, &C_ts, &T_ts, cpuid)) < 0)
+        {
+            perror("create_reserve_group");
+            return -1; // Return error
+        }
+        printf("Group ID: %d\n", num_to_disp);
+    }
+    else if (strcmp(cmd, "join") == 0)
+    {
+        // int join_reserve_group(pid t tid, int id);
+        printf("join_reserve_group(tid=%d, id=%d)\n", tid, cpuid);
+        if (syscall(__NR_join_reserve_group, tid, cpuid) < 0)
+        {
+            perror("join_reserve_group");
+            return -1; // Return error
+        }
+    }
+    else if (strcmp(cmd, "ungroup") == 0)
+    {
+        // int destroy_reserve_group(int id);
+        printf("destroy_reserve_group(id=%d)\n", cpuid);
+        if (syscall(__NR_destroy_reserve_group, cpuid) < 0)
+        {
+            perror("destroy_reserve_group");
+            return -1; // Return error
+        }
+    }
+    else if (strcmp(cmd, "blocking") == 0)
+    {
+        // int set_reserve_blocking(pid t tid, struct timespec *cs);
+        C_ts.tv_sec = C / 1000;               // ms -> s
+        C_ts.tv_nsec = (C % 1000) * MS_IN_NS; // ms -> ns
+
+        printf("set_reserve_blocking(tid=%d, cs=%ld.%09ld)\n", tid, C_ts.tv_sec, C_ts.tv_nsec);
+        if (syscall(__NR_set_reserve_blocking, tid, &C_ts) < 0)
+        {
+            perror("set_reserve_blocking");
+            return -1; // Return error
+        }
+    }
     else if (strcmp(cmd, "cancel") == 0)
     {
         // int cancel_reserve(pid t tid);
@@ -11,31 +11,34 @@
  * The terminal screen must not scroll each time it updates. The updated information
  * should cleanly overwrite the old information, much like the program top.
  * Only as many processes as fit into the current terminal size should be displayed.
+ *
+ * The threads are paged in with list_rt_threads_ex, and the screen is only redrawn when the rt
+ * generation returned with them or the terminal size changed since the last update.
+ * rtps waits for changes on an rt_thread_watch descriptor instead of waking up every 2 seconds,
+ * and shows the last changes it was told about, so that short-lived rt threads are seen too.
+ * Without rt_thread_watch it falls back to the 2 second refresh.
  */
 
 #include <sys/ioctl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
 #include <linux/termios.h>
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <linux/rtes.h>
 
-#define SYS_COUNT 377 // count_rt_threads
-#define SYS_LIST 378 // list_rt_threads
 #define MAX_THREADS 200
+#define PAGE_THREADS 64
+#define RECENT_EVENTS 5
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 
-struct rt_thread
-{
-    pid_t tid;    /* Thread ID */
-    pid_t pid;    /* Process ID */
-    int priority; /* Thread Priority */
-    char name[20];   /* Name (command) */
-};
-
 // void get_terminal_size(int *rows, int *cols)
 // {
 //     struct winsize ws;
@@ -69,24 +72,113 @@ void get_terminal_size(int *rows, int *cols) {
     printf("Terminal size: rows = %d, cols = %d\n", *rows, *cols);
 }
 
-void print_threads(struct rt_thread* list, int loop_len, int rows)
+void print_threads(struct rt_thread_info* list, int loop_len, int rows)
 {
     int i = 0;
     int num = 0;
-    // Dummy data for process display (replace with actual process data)
-    printf("TID      PID      PRIORITY      COMMAND\n");
-    printf("-------------------------------------\n");
+    printf("TID      PID      PRIORITY  CPU  RESERVE          COMMAND\n");
+    printf("---------------------------------------------------------\n");
     // printf("rows = %d\n", rows);
     num = MIN(loop_len, rows - 4);
     for (i = 0; i < num; i++)
     {
-        // printf("%6d  %6d   %4d   %s\n",
-        //         list[i]->tid, list[i]->pid, list[i]->priority, list[i]->name);
-        printf("%6d  %6d   %4d   %s\n",
-                list[i].tid, list[i].pid, list[i].priority, list[i].name);
+        if (list[i].reserved)
+            printf("%6d  %6d   %4d     %3d  %5u/%-6u@%-2d %s\n", list[i].tid, list[i].pid, list[i].priority,
+                   list[i].cpu, list[i].C_us / 1000, list[i].T_us / 1000, list[i].reserve_cpu, list[i].name);
+        else
+            printf("%6d  %6d   %4d     %3d  %-15s %s\n", list[i].tid, list[i].pid, list[i].priority,
+                   list[i].cpu, "-", list[i].name);
     }
 }
 
+/**
+ * Page all real-time threads into *list, growing it as needed
+ * Returns the number of threads and the generation they were listed at, which is only consistent if it
+ * did not change while paging, or -1 on error.
+ */
+int list_threads(struct rt_thread_info **list, int *size, unsigned int *generation)
+{
+    struct rt_list_cursor cursor = {0, 0};
+    unsigned int first_generation;
+    int n, total;
+
+    do {
+        total = 0;
+        cursor.next_tid = 0;
+        do {
+            if (total + PAGE_THREADS > *size) {
+                *size = total + PAGE_THREADS;
+                *list = realloc(*list, *size * sizeof(struct rt_thread_info));
+                if (!*list)
+                    return -1;
+            }
+            n = syscall(__NR_list_rt_threads_ex, *list + total, PAGE_THREADS, &cursor);
+            if (n < 0)
+                return -1;
+            if (total == 0)
+                first_generation = cursor.generation;
+            total += n;
+        } while (cursor.next_tid != 0);
+    } while (cursor.generation != first_generation);    // Changed while paging, list again
+
+    *generation = cursor.generation;
+    return total;
+}
+
+// Last changes read from the watch descriptor, oldest first
+struct rt_thread_event recent[RECENT_EVENTS];
+int num_recent = 0;
+
+void add_recent(struct rt_thread_event *ev)
+{
+    if (ev->tid == 0)
+        return; // Lost changes, the listing is redone anyway
+    if (num_recent == RECENT_EVENTS)
+    {
+        memmove(recent, recent + 1, (RECENT_EVENTS - 1) * sizeof(recent[0]));
+        num_recent--;
+    }
+    recent[num_recent++] = *ev;
+}
+
+void print_recent(void)
+{
+    int i;
+
+    printf("Recent changes:\n");
+    for (i = 0; i < num_recent; i++)
+    {
+        if (recent[i].old_prio == 0)
+            printf("  %6d  joined at priority %u\n", recent[i].tid, recent[i].new_prio);
+        else if (recent[i].new_prio == 0)
+            printf("  %6d  left (priority %u)\n", recent[i].tid, recent[i].old_prio);
+        else
+            printf("  %6d  priority %u -> %u\n", recent[i].tid, recent[i].old_prio, recent[i].new_prio);
+    }
+}
+
+// Block until the rt threads change or a signal such as SIGWINCH arrives, then read all the changes
+void wait_for_changes(int watch_fd)
+{
+    struct rt_thread_event events[32];
+    struct pollfd pfd = { .fd = watch_fd, .events = POLLIN };
+    ssize_t len;
+    int i;
+
+    if (poll(&pfd, 1, -1) <= 0)
+        return; // Interrupted
+    while ((len = read(watch_fd, events, sizeof(events))) > 0)
+    {
+        for (i = 0; i < len / (ssize_t)sizeof(events[0]); i++)
+            add_recent(&events[i]);
+    }
+}
+
+void handle_sigwinch(int sig)
+{
+    // Nothing to do, interrupting poll() is enough to redraw with the new size
+}
+
 void handle_sigint(int sig)
 {
     // Show the cursor again when the program ends
@@ -99,46 +191,73 @@ void clear_screen() {
 }
 
 int compare(const void *a, const void *b) {
-    struct rt_thread *t1 = (struct rt_thread *)a;
-    struct rt_thread *t2 = (struct rt_thread *)b;
+    struct rt_thread_info *t1 = (struct rt_thread_info *)a;
+    struct rt_thread_info *t2 = (struct rt_thread_info *)b;
     return t2->priority - t1->priority;     // Sort in descending order
 }
 
 
 int main() {
     int rows, cols, num_to_disp, count;
-    int refresh_rate = 2; // refresh rate in 2 seconds
-    struct rt_thread rt_threads_list[MAX_THREADS];      // use stack memory
+    int last_rows = -1, last_cols = -1, size = 0;
+    unsigned int generation, last_generation = 0;
+    int refresh_rate = 2; // refresh rate in 2 seconds, without rt_thread_watch
+    int watch_fd;
+    struct rt_thread_info *rt_threads_list = NULL;
+    struct sigaction sa;
 
     signal(SIGINT, handle_sigint);
+    // Without SA_RESTART so that a resize interrupts poll()
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigwinch;
+    sigaction(SIGWINCH, &sa, NULL);
     printf("\033[?25l"); // Hide the cursor
 
+    // Opened before the first listing so that no change is missed in between
+    watch_fd = syscall(__NR_rt_thread_watch, O_NONBLOCK | O_CLOEXEC);
+
     while (1) {
-        clear_screen();
+        // Call list of threads
+        num_to_disp = list_threads(&rt_threads_list, &size, &generation);
+        if (num_to_disp < 0){
+            perror("Error: sys_list failed\n");
+            return -1;
+        }
+
         // Get current terminal size
         get_terminal_size(&rows, &cols);
-        // Move the cursor to the top of the terminal without clearing the content
-        // printf("\033[H");
-        count = syscall(SYS_COUNT);
+
+        // Nothing to redraw
+        if (generation == last_generation && rows == last_rows && cols == last_cols) {
+            if (watch_fd >= 0)
+                wait_for_changes(watch_fd);
+            else
+                sleep(refresh_rate);
+            continue;
+        }
+        last_generation = generation;
+        last_rows = rows;
+        last_cols = cols;
+
+        clear_screen();
+        count = syscall(__NR_count_rt_threads);
         if (count < 0) {
             printf("Error: Unable to get real-time thread count\n");
             break;
         }
         printf("Number of real-time threads: %d\n", count);
 
-        // Call list of threads
-        num_to_disp = syscall(SYS_LIST, rt_threads_list, MAX_THREADS);
-        if (num_to_disp < 0){
-            perror("Error: sys_list failed\n");
-            return -1;
-        }
-
         // Print the threads
-        qsort(rt_threads_list, num_to_disp, sizeof(struct rt_thread), compare);
-        print_threads(rt_threads_list, num_to_disp, rows); 
-     
-        // Sleep for the refresh rate before updating again
-        sleep(refresh_rate);
+        qsort(rt_threads_list, num_to_disp, sizeof(struct rt_thread_info), compare);
+        if (watch_fd >= 0) {
+            print_threads(rt_threads_list, num_to_disp, rows - RECENT_EVENTS - 1);
+            print_recent();
+            wait_for_changes(watch_fd);
+        } else {
+            print_threads(rt_threads_list, num_to_disp, rows); 
+            // Sleep for the refresh rate before updating again
+            sleep(refresh_rate);
+        }
     }
     // Show the cursor again when the program ends
     printf("\033[?25h");
@@ -4,21 +4,11 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
-
-#define SYS_COUNT 377
-#define SYS_LIST 378
-
-struct rt_thread
-{
-    pid_t tid;    /* Thread ID */
-    pid_t pid;    /* Process ID */
-    int priority; /* Thread Priority */
-    char *name;   /* Name (command) */
-};
+#include <linux/rtes.h>
 
 int main() {
     int i = 0;
-    long count = syscall(SYS_COUNT);
+    long count = syscall(__NR_count_rt_threads);
     if (count < 0) {
         printf("Error: Unable to get real-time thread count\n");
         return -1;
@@ -28,7 +18,7 @@ int main() {
     unsigned int num_threads = 50;
     struct rt_thread *rt_threads_list = malloc(count * sizeof(struct rt_thread));
 
-    if (syscall(SYS_LIST, rt_threads_list, num_threads) < 0) {
+    if (syscall(__NR_list_rt_threads, rt_threads_list, num_threads) < 0) {
         printf("Error: Unable to get real-time thread list\n");
         free(rt_threads_list);
         return -1;
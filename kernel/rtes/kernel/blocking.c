@@ -0,0 +1,89 @@
+/**
+ * Blocking terms
+ *  Reserved threads that share PI futexes (rt_mutex) are blocked by lower priority reserved threads of their
+ *  cpu while those hold the lock. With priority inheritance a thread is blocked at most once by each lower
+ *  priority thread, for at most the longest critical section cs_j of that thread, so admission adds
+ *  B_i = sum of cs_j over the tasks of the cpu below task i:
+ *   - RM: R_i = C_i + B_i + sum_{j<i} ceil(R_i / T_j) * C_j
+ *   - EDF: sum_{j<=k} C_j / D_j + B_k / D_k <= 1 for every task k in deadline order
+ *
+ *  cs_j is the larger of
+ *   - the critical section declared with set_reserve_blocking(pid, cs)
+ *   - the longest time a reserved thread waited in rt_mutex_slowlock for a lock held by thread j, which
+ *     includes the preemption of the holder and is conservative. A measurement above the declared length
+ *     is reported once and used by every admission test from then on.
+ *  and never more than C_j, a critical section being part of the job.
+ *
+ *  Budget-aware PI: a boosted holder runs its critical section on its own budget. If the budget runs out
+ *  while it is boosted it is not throttled with the lock held, which would block the waiter until its next
+ *  period, but runs on for up to cs and the extra time is taken from its next job as with
+ *  RTES_OVERRUN_BORROW (see overrun.c).
+ *
+ * Global reservations are not covered.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/reservation.h>
+
+static bool blocking_capable(struct task_struct *task)
+{
+    return task && task->reservation_data && task->reservation_data->has_reservation;
+}
+
+// Critical section length used for res_data by the admission test
+u64 blocking_cs_ns(struct reservation_data *res_data)
+{
+    return min(max(res_data->block_declared_ns, res_data->block_measured_ns),
+               (u64)timespec_to_ns(&res_data->reserve_C));
+}
+
+/**
+ * Called by rt_mutex_slowlock with the wait_lock held when current is about to block on a lock of owner
+ * Returns owner with a reference if the wait is measured, NULL otherwise.
+ */
+struct task_struct *blocking_begin(struct task_struct *owner, u64 *start_ns)
+{
+    if (!blocking_capable(current) || !blocking_capable(owner) || owner == current)
+        return NULL;
+
+    get_task_struct(owner);
+    *start_ns = ktime_to_ns(ktime_get());
+    return owner;
+}
+
+// The wait started by blocking_begin is over, ret is 0 if the lock was taken
+void blocking_end(struct task_struct *owner, u64 start_ns, int ret)
+{
+    struct reservation_data *res_data = owner->reservation_data;
+    u64 waited_ns = ktime_to_ns(ktime_get()) - start_ns;
+
+    if (!ret && waited_ns > res_data->block_measured_ns) {
+        res_data->block_measured_ns = waited_ns;
+        if (waited_ns > res_data->block_declared_ns && !res_data->block_reported) {
+            res_data->block_reported = true;
+            printk(KERN_WARNING "PID %d blocked PID %d for %llu us, more than its declared critical section\n",
+                   owner->pid, current->pid, div_u64(waited_ns, 1000));
+        }
+    }
+    put_task_struct(owner);
+}
+
+/**
+ * Called from context_switch when prev used up budget_ns, with the rq lock held
+ * Returns true if prev holds a lock wanted by a higher priority thread and keeps running on its critical
+ * section, false if it is throttled.
+ */
+bool blocking_extend(struct reservation_data *res_data, u64 budget_ns)
+{
+    struct task_struct *task = res_data->task;
+
+    if (task->prio >= task->normal_prio)
+        return false;   // Not boosted by priority inheritance
+    if (res_data->exec_accumulated_time >= budget_ns + blocking_cs_ns(res_data))
+        return false;
+
+    res_data->pi_borrowed = true;
+    return true;
+}
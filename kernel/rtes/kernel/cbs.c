@@ -0,0 +1,118 @@
+/**
+ * Constant Bandwidth Server reservations
+ *  A periodic reservation gets its budget C back only at the period boundaries of its replenishment timer,
+ *  so a thread woken by an event just after a boundary either waits for the next one or wastes the budget.
+ *  A CBS reservation (set_reserve_type(..., RESERVE_CBS)) instead keeps a server deadline d and the budget
+ *  consumed against it:
+ *   - on wakeup, if the remaining budget q no longer fits the bandwidth left until d (q > (d - now) * C / T)
+ *     or d has passed, the server starts over with d = now + T and a full budget
+ *   - on exhaustion, d is postponed by T and the budget recharged, so the thread keeps running right away
+ *     as long as it is not ahead of its bandwidth
+ *   - a thread that is ahead (d - T > now after the postponement) is throttled until d - T, which keeps its
+ *     consumption at C per T in any window (hard CBS) since the reserved threads run under fixed priorities
+ *
+ * Admission is unchanged: the server is accounted as a task with bandwidth C/T. The periodic timer keeps
+ * running for the statistics but does not replenish or wake a CBS reservation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/reservation.h>
+
+
+// End of the throttling: the budget was already recharged when the thread was throttled
+static enum hrtimer_restart cbs_timer_callback(struct hrtimer *timer)
+{
+    struct reservation_data *res_data = container_of(timer, struct reservation_data, cbs_timer);
+    struct task_struct *task = res_data->task;
+
+    res_data->cbs_throttled = false;
+    if (task->state == TASK_UNINTERRUPTIBLE) {
+        wake_up_process(task);
+        rtes_event(RTES_EVENT_REPLENISH, task, res_data->reserve_cpu, res_data->cbs_used_ns);
+    }
+
+    return HRTIMER_NORESTART;
+}
+
+// Called once when the reservation data is created
+void cbs_init(struct reservation_data *res_data)
+{
+    hrtimer_init(&res_data->cbs_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    res_data->cbs_timer.function = cbs_timer_callback;
+}
+
+// Start a new server instance: full budget, deadline one period from now
+void cbs_start(struct reservation_data *res_data)
+{
+    res_data->cbs_deadline_ns = ktime_to_ns(ktime_get()) + timespec_to_ns(&res_data->reserve_T);
+    res_data->cbs_used_ns = 0;
+    res_data->cbs_throttled = false;
+}
+
+// Stop the server when the reservation is reset, cancelled or the thread exits
+void cbs_stop(struct reservation_data *res_data)
+{
+    hrtimer_cancel(&res_data->cbs_timer);
+    res_data->cbs_throttled = false;
+}
+
+// Wakeup rule, called with the rq lock held when a thread is activated
+void cbs_wakeup(struct reservation_data *res_data)
+{
+    u64 now, budget_ns, period_ns, left_ns;
+
+    if (res_data->cbs_throttled)
+        return; // The throttling timer decides when the budget comes back
+
+    now = ktime_to_ns(ktime_get());
+    budget_ns = timespec_to_ns(&res_data->reserve_C);
+    period_ns = timespec_to_ns(&res_data->reserve_T);
+
+    if (now >= res_data->cbs_deadline_ns) {
+        cbs_start(res_data);
+        return;
+    }
+
+    // q / (d - now) > C / T, without dividing: q * T > (d - now) * C, in us since both products are up to
+    // C * T and would overflow in ns for periods above 4 s
+    left_ns = budget_ns > res_data->cbs_used_ns ? budget_ns - res_data->cbs_used_ns : 0;
+    if (div_u64(left_ns, NSEC_PER_USEC) * div_u64(period_ns, NSEC_PER_USEC) >
+        div_u64(res_data->cbs_deadline_ns - now, NSEC_PER_USEC) * div_u64(budget_ns, NSEC_PER_USEC))
+        cbs_start(res_data);
+}
+
+/**
+ * Charge delta_ns of execution to the server, called from context_switch when the thread is switched out
+ * Returns true if the thread has to be throttled, the throttling timer is already armed in that case.
+ */
+bool cbs_charge(struct reservation_data *res_data, u64 delta_ns)
+{
+    u64 now, budget_ns, period_ns, replenish_ns;
+
+    budget_ns = timespec_to_ns(&res_data->reserve_C);
+    period_ns = timespec_to_ns(&res_data->reserve_T);
+
+    res_data->cbs_used_ns += delta_ns;
+    if (res_data->cbs_used_ns < budget_ns)
+        return false;
+
+    // Postpone the deadline and recharge, once per budget consumed
+    while (res_data->cbs_used_ns >= budget_ns) {
+        res_data->cbs_used_ns -= budget_ns;
+        res_data->cbs_deadline_ns += period_ns;
+    }
+
+    now = ktime_to_ns(ktime_get());
+    replenish_ns = res_data->cbs_deadline_ns - period_ns;
+    if (replenish_ns <= now)
+        return false;
+
+    // Ahead of its bandwidth, no wakeup of softirqd here since the rq lock is held
+    res_data->cbs_throttled = true;
+    __hrtimer_start_range_ns(&res_data->cbs_timer, ns_to_ktime(replenish_ns), 0, HRTIMER_MODE_ABS_PINNED, 0);
+    return true;
+}
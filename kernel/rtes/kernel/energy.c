@@ -317,8 +317,7 @@ int create_energy_files(void)
         return -1;
     }
 
-    // Dynamically create /sys/rtes/tasks/<pid>/energy
-    // TODO dynamically create the pid files
+    // /sys/rtes/tasks/<pid>/energy is created with the directory of each reservation, see jobstats.c
 
     return 0; // Success
 }
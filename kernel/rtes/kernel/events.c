@@ -0,0 +1,181 @@
+/**
+ * Reservation events over generic netlink
+ *  The "RTES_EVENTS" generic netlink family multicasts what happens to reservations to its "events" group,
+ *  so a monitor subscribes once instead of polling /sys/rtes:
+ *   - RTES_EVENT_ADMIT, RTES_EVENT_REJECT: set_reserve admitted the thread on cpu, value is C in ns, or
+ *     did not find a cpu it fits on
+ *   - RTES_EVENT_CANCEL, RTES_EVENT_EXIT: the reservation was cancelled or its thread exited
+ *   - RTES_EVENT_THROTTLE: the thread was suspended with its budget used up, value is its execution time
+ *   - RTES_EVENT_REPLENISH: a new period woke the suspended thread, value is the execution time of the job
+ *   - RTES_EVENT_OVERRUN: the thread went over its budget, value is by how much in ns when it is known
+ *
+ *  Events are recorded into a buffer of the cpu they happen on, from any context, and sent by a work item
+ *  event_interval_ms (/sys/rtes/config) after the first one in the buffer, as one RTES_EVENTS_CMD_EVENTS
+ *  message per cpu with
+ *   - RTES_EVENTS_A_CPU: u32
+ *   - RTES_EVENTS_A_DROPPED: u32, events that did not fit in the buffer since the last message
+ *   - RTES_EVENTS_A_EVENTS: array of struct rtes_event
+ *  so a cpu sends at most RTES_EVENT_BATCH events per interval. Nothing is recorded without subscribers.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/irq_work.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/reservation.h>
+#include <net/genetlink.h>
+
+struct rtes_event_buf {
+    raw_spinlock_t lock;
+    unsigned int n;
+    u32 dropped;
+    struct irq_work work;
+    struct rtes_event ev[RTES_EVENT_BATCH];
+};
+
+static DEFINE_PER_CPU(struct rtes_event_buf, rtes_event_bufs);
+
+unsigned int event_interval_ms = 100;
+
+static bool events_registered;
+
+static struct genl_family rtes_events_family = {
+    .id = GENL_ID_GENERATE,
+    .name = RTES_EVENTS_GENL_NAME,
+    .version = RTES_EVENTS_GENL_VERSION,
+    .maxattr = RTES_EVENTS_A_MAX,
+};
+
+static struct genl_multicast_group rtes_events_mcgrp = {
+    .name = RTES_EVENTS_MCGRP_NAME,
+};
+
+static void rtes_events_flush(struct work_struct *work);
+static DECLARE_DELAYED_WORK(rtes_events_work, rtes_events_flush);
+
+// Send the buffer of cpu, called by the flush work. Returns false if it has to be tried again.
+static bool rtes_events_send(int cpu)
+{
+    struct rtes_event_buf *buf = &per_cpu(rtes_event_bufs, cpu);
+    struct sk_buff *skb;
+    struct nlattr *nla;
+    unsigned long flags;
+    void *hdr;
+    u32 dropped;
+    unsigned int n;
+
+    if (!ACCESS_ONCE(buf->n))
+        return true;
+
+    skb = genlmsg_new(nla_total_size(sizeof(u32)) * 2 +
+                      nla_total_size(sizeof(struct rtes_event) * RTES_EVENT_BATCH), GFP_KERNEL);
+    if (!skb)
+        return false;
+    hdr = genlmsg_put(skb, 0, 0, &rtes_events_family, 0, RTES_EVENTS_CMD_EVENTS);
+    if (!hdr)
+        goto err;
+
+    // Take the events out, the buffer takes new ones from here on
+    raw_spin_lock_irqsave(&buf->lock, flags);
+    n = buf->n;
+    dropped = buf->dropped;
+    nla = nla_reserve(skb, RTES_EVENTS_A_EVENTS, n * sizeof(struct rtes_event));
+    if (nla) {
+        memcpy(nla_data(nla), buf->ev, n * sizeof(struct rtes_event));
+        buf->n = 0;
+        buf->dropped = 0;
+    }
+    raw_spin_unlock_irqrestore(&buf->lock, flags);
+
+    if (!nla || nla_put_u32(skb, RTES_EVENTS_A_CPU, cpu) || nla_put_u32(skb, RTES_EVENTS_A_DROPPED, dropped))
+        goto err;
+
+    genlmsg_end(skb, hdr);
+    genlmsg_multicast(skb, 0, rtes_events_mcgrp.id, GFP_KERNEL);
+    return true;
+err:
+    nlmsg_free(skb);
+    return false;
+}
+
+static void rtes_events_flush(struct work_struct *work)
+{
+    bool sent = true;
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        sent &= rtes_events_send(cpu);
+
+    // Nothing kicks the flush again while events are left in a buffer
+    if (!sent)
+        schedule_delayed_work(&rtes_events_work, msecs_to_jiffies(event_interval_ms));
+}
+
+// The first event of a buffer schedules the flush, it is recorded where the work cannot be queued
+static void rtes_events_kick(struct irq_work *work)
+{
+    schedule_delayed_work(&rtes_events_work, msecs_to_jiffies(event_interval_ms));
+}
+
+/**
+ * Record an event of task on the reservation cpu, value depends on type
+ * Called from any context, including with the rq lock held.
+ */
+void rtes_event(enum rtes_event_type type, struct task_struct *task, int cpu, u64 value)
+{
+    struct rtes_event_buf *buf;
+    struct rtes_event *ev;
+    unsigned long flags;
+    bool first = false;
+
+    if (!events_registered || !netlink_has_listeners(init_net.genl_sock, rtes_events_mcgrp.id))
+        return;
+
+    local_irq_save(flags);
+    buf = &__get_cpu_var(rtes_event_bufs);
+    raw_spin_lock(&buf->lock);
+    if (buf->n < RTES_EVENT_BATCH) {
+        ev = &buf->ev[buf->n];
+        ev->time_ns = ktime_to_ns(ktime_get());
+        ev->value = value;
+        ev->tid = task->pid;
+        ev->type = type;
+        ev->cpu = cpu;
+        first = buf->n++ == 0;
+    } else {
+        buf->dropped++;
+    }
+    raw_spin_unlock(&buf->lock);
+    if (first)
+        irq_work_queue(&buf->work);
+    local_irq_restore(flags);
+}
+
+static int __init rtes_events_init(void)
+{
+    struct rtes_event_buf *buf;
+    int cpu, ret;
+
+    for_each_possible_cpu(cpu) {
+        buf = &per_cpu(rtes_event_bufs, cpu);
+        raw_spin_lock_init(&buf->lock);
+        init_irq_work(&buf->work, rtes_events_kick);
+    }
+
+    ret = genl_register_family(&rtes_events_family);
+    if (ret)
+        return ret;
+    ret = genl_register_mc_group(&rtes_events_family, &rtes_events_mcgrp);
+    if (ret) {
+        genl_unregister_family(&rtes_events_family);
+        return ret;
+    }
+    events_registered = true;
+    return 0;
+}
+
+// After genetlink itself, like taskstats
+late_initcall(rtes_events_init);
@@ -0,0 +1,201 @@
+/**
+ * Group reservations
+ *  A group reservation is one budget C per period T (deadline D = T) on one cpu, shared by any number of
+ *  threads. create_reserve_group(C, T, cpuid) admits it as a single task and returns its id,
+ *  join_reserve_group(tid, id) makes a thread a member and pins it to the cpu of the group,
+ *  cancel_reserve(tid) takes a member out again and destroy_reserve_group(id) takes all of them out and
+ *  gives the bandwidth back.
+ *
+ *  - every member is charged in context_switch against the budget of the group, and once the group has
+ *    used it up each member is suspended when it is next switched out (a member switched in meanwhile is
+ *    switched out right away)
+ *  - one replenishment timer per group releases all members at the start of every period that it
+ *    suspended or that called end_job, other sleeps of the members are left alone
+ *  - members get their priority from the RM assignment like other reserved threads, next to each other,
+ *    and have no sysfs files of their own
+ *
+ * Groups are RM only and never split. context_switch reads the group of a thread without a lock, so a
+ * group is freed only after a grace period of sched RCU.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/rcupdate.h>
+#include <linux/reservation.h>
+
+static LIST_HEAD(reserve_groups);
+static DEFINE_SPINLOCK(reserve_groups_lock);
+static int next_group_id = 1;
+
+
+// Start of a period: the group gets its budget back and the members are released
+static enum hrtimer_restart group_timer_callback(struct hrtimer *timer)
+{
+    struct reserve_group *group = container_of(timer, struct reserve_group, timer);
+    struct reservation_data *res_data;
+    u64 release_ns = ktime_to_ns(hrtimer_get_expires(timer));
+
+    atomic64_set(&group->exec_ns, 0);
+    group->throttled = false;
+    group->period_count++;
+
+    // context_switch never takes the group lock, so the members can be woken with it held
+    spin_lock(&group->lock);
+    list_for_each_entry(res_data, &group->members, group_node) {
+        job_release(res_data, release_ns, task_curr(res_data->task));
+        exec_stats_add(res_data, res_data->exec_accumulated_time);
+        if (res_data->group_suspended) {
+            res_data->group_suspended = false;
+            wake_up_process(res_data->task);
+            rtes_event(RTES_EVENT_REPLENISH, res_data->task, group->cpu, res_data->exec_accumulated_time);
+        }
+        res_data->exec_accumulated_time = 0;
+    }
+    spin_unlock(&group->lock);
+
+    hrtimer_forward_now(timer, timespec_to_ktime(group->T));
+    return HRTIMER_RESTART;
+}
+
+/**
+ * Charge delta_ns of a member to its group, called from context_switch with the rq lock held
+ * Returns true if the group is out of budget and the member has to be suspended.
+ */
+bool reserve_group_charge(struct reserve_group *group, u64 delta_ns)
+{
+    if (atomic64_add_return(delta_ns, &group->exec_ns) >= timespec_to_ns(&group->C))
+        group->throttled = true;
+    return group->throttled;
+}
+
+// New group with an admitted (C, T) on cpu, the caller accounts it in the processor bucket
+struct reserve_group *reserve_group_create(struct timespec c, struct timespec t, int cpu)
+{
+    struct reserve_group *group;
+
+    group = kzalloc(sizeof(*group), GFP_KERNEL);
+    if (!group)
+        return NULL;
+
+    group->C = c;
+    group->T = t;
+    group->D = t;
+    group->cpu = cpu;
+    spin_lock_init(&group->lock);
+    INIT_LIST_HEAD(&group->members);
+    atomic64_set(&group->exec_ns, 0);
+    hrtimer_init(&group->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    group->timer.function = group_timer_callback;
+
+    spin_lock(&reserve_groups_lock);
+    group->id = next_group_id++;
+    list_add_tail(&group->node, &reserve_groups);
+    spin_unlock(&reserve_groups_lock);
+
+    hrtimer_start(&group->timer, timespec_to_ktime(t), HRTIMER_MODE_REL);
+    return group;
+}
+
+// Stop and free a group without members
+void reserve_group_free(struct reserve_group *group)
+{
+    spin_lock(&reserve_groups_lock);
+    list_del(&group->node);
+    spin_unlock(&reserve_groups_lock);
+
+    hrtimer_cancel(&group->timer);
+    // A context switch may still be charging a member that left
+    synchronize_sched();
+    kfree(group);
+}
+
+// Find a group by id, the caller serializes against reserve_group_free
+struct reserve_group *reserve_group_find(int id)
+{
+    struct reserve_group *group, *found = NULL;
+
+    spin_lock(&reserve_groups_lock);
+    list_for_each_entry(group, &reserve_groups, node) {
+        if (group->id == id) {
+            found = group;
+            break;
+        }
+    }
+    spin_unlock(&reserve_groups_lock);
+    return found;
+}
+
+// Any group on any cpu, groups are partitioned and not mixed with global reservations
+bool reserve_groups_exist(void)
+{
+    bool exist;
+
+    spin_lock(&reserve_groups_lock);
+    exist = !list_empty(&reserve_groups);
+    spin_unlock(&reserve_groups_lock);
+    return exist;
+}
+
+/**
+ * Add the groups of cpuid to the task set of an admission test, each as a single task
+ * Returns the number of groups added, or -ENOMEM if there are more than max.
+ */
+int reserve_group_params(int cpuid, struct timespec *c, struct timespec *t, struct timespec *d, int max)
+{
+    struct reserve_group *group;
+    int n = 0;
+
+    spin_lock(&reserve_groups_lock);
+    list_for_each_entry(group, &reserve_groups, node) {
+        if (group->cpu != cpuid)
+            continue;
+        if (n >= max) {
+            spin_unlock(&reserve_groups_lock);
+            return -ENOMEM;
+        }
+        c[n] = group->C;
+        t[n] = group->T;
+        d[n] = group->D;
+        n++;
+    }
+    spin_unlock(&reserve_groups_lock);
+    return n;
+}
+
+// Make res_data a member of group, its reservation parameters are already those of the group
+void reserve_group_add(struct reserve_group *group, struct reservation_data *res_data)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&group->lock, flags);
+    list_add_tail(&res_data->group_node, &group->members);
+    group->nr_members++;
+    rcu_assign_pointer(res_data->group, group);
+    spin_unlock_irqrestore(&group->lock, flags);
+}
+
+// Take res_data out of its group
+void reserve_group_del(struct reservation_data *res_data)
+{
+    struct reserve_group *group = res_data->group;
+    unsigned long flags;
+
+    if (!group)
+        return;
+
+    spin_lock_irqsave(&group->lock, flags);
+    list_del_init(&res_data->group_node);
+    group->nr_members--;
+    res_data->group = NULL;
+    spin_unlock_irqrestore(&group->lock, flags);
+
+    // Not released by the group timer any more
+    if (res_data->group_suspended) {
+        res_data->group_suspended = false;
+        wake_up_process(res_data->task);
+    }
+}
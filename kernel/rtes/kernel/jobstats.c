@@ -0,0 +1,316 @@
+/**
+ * Per-job response time and deadline miss tracking
+ *  Every replenishment of a reservation releases a new job, and a job completes when the thread calls
+ *  end_job. For each reservation the kernel keeps:
+ *   - a histogram of response times (release -> end_job)
+ *   - a histogram of release latencies (release -> first time the thread is switched in)
+ *   - the number of jobs that did not complete before their deadline D
+ *
+ * The data is exported under /sys/rtes/tasks/<pid>/:
+ *   /sys/rtes/tasks/<pid>/response_time     :   response time histogram (us)
+ *   /sys/rtes/tasks/<pid>/release_latency   :   release latency histogram (us)
+ *   /sys/rtes/tasks/<pid>/deadline_misses   :   released, completed and missed job counts
+ *   /sys/rtes/tasks/<pid>/exec_stats        :   execution time per period summary (see stats.c)
+ *   /sys/rtes/tasks/<pid>/profile           :   profile mode progress and recommended budget
+ *   /sys/rtes/tasks/<pid>/util              :   utilization per period while taskmon is enabled (see taskmon.c)
+ *   /sys/rtes/tasks/<pid>/energy            :   mJ energy consumed by the thread
+ *   /sys/rtes/tasks/<pid>/params            :   reservation parameters
+ */
+
+#include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/slab.h>
+#include <linux/sysfs.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/math64.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/rcupdate.h>
+#include <linux/reservation.h>
+#include "taskmon.h"
+
+
+// Clear all job statistics, called when a reservation is (re)set
+void reset_job_stats(struct reservation_data *res_data)
+{
+    struct job_stats *js = &res_data->jobs;
+    unsigned long flags;
+
+    spin_lock_irqsave(&js->lock, flags);
+    js->release_ns = 0;
+    js->last_release_ns = 0;
+    js->job_active = false;
+    js->job_missed = false;
+    js->release_pending = false;
+    js->jobs_released = 0;
+    js->jobs_completed = 0;
+    js->deadline_misses = 0;
+    memset(&js->response_hist, 0, sizeof(js->response_hist));
+    memset(&js->release_hist, 0, sizeof(js->release_hist));
+    spin_unlock_irqrestore(&js->lock, flags);
+}
+
+/**
+ * Called from the replenishment timer at the start of every period
+ * @param release_ns the nominal release time (timer expiry)
+ * @param running the thread is on a cpu right now, so its release latency is zero
+ *
+ * A job that is still active at the next release missed its deadline. Threads that never call end_job
+ * have no job boundaries, so every period is treated as a new job for them.
+ */
+void job_release(struct reservation_data *res_data, u64 release_ns, bool running)
+{
+    struct job_stats *js = &res_data->jobs;
+    unsigned long flags;
+
+    spin_lock_irqsave(&js->lock, flags);
+    js->jobs_released++;
+    js->last_release_ns = release_ns;
+
+    if (js->job_active && js->jobs_completed) {
+        // Job in progress is past its deadline, it keeps its original release time
+        if (!js->job_missed) {
+            js->deadline_misses++;
+            js->job_missed = true;
+        }
+    } else {
+        js->release_ns = release_ns;
+        js->job_active = true;
+        js->job_missed = false;
+    }
+
+    if (running) {
+        hist_add(&js->release_hist, 0);
+        js->release_pending = false;
+    } else {
+        js->release_pending = true;
+    }
+    spin_unlock_irqrestore(&js->lock, flags);
+}
+
+// Called from context_switch when a reserved thread is switched in
+void job_switch_in(struct reservation_data *res_data)
+{
+    struct job_stats *js = &res_data->jobs;
+    s64 latency;
+
+    if (!js->release_pending)
+        return;
+
+    spin_lock(&js->lock);   // irqs are already off in context_switch
+    if (js->release_pending) {
+        latency = ktime_to_ns(ktime_get()) - js->last_release_ns;
+        hist_add(&js->release_hist, latency > 0 ? latency : 0);
+        js->release_pending = false;
+    }
+    spin_unlock(&js->lock);
+}
+
+// Called from end_job when the current job is done
+void job_complete(struct reservation_data *res_data)
+{
+    struct job_stats *js = &res_data->jobs;
+    unsigned long flags;
+    u64 deadline_ns = timespec_to_ns(&res_data->reserve_D);
+    s64 response;
+
+    spin_lock_irqsave(&js->lock, flags);
+    if (js->job_active) {
+        response = ktime_to_ns(ktime_get()) - js->release_ns;
+        if (response < 0)
+            response = 0;
+        hist_add(&js->response_hist, response);
+
+        if (response > deadline_ns && !js->job_missed)
+            js->deadline_misses++;
+
+        js->jobs_completed++;
+        js->job_active = false;
+        js->job_missed = false;
+    }
+    spin_unlock_irqrestore(&js->lock, flags);
+}
+
+/**
+ * /sys/rtes/tasks/<pid> directory of a reservation
+ * The files are the default attributes of its kobj_type, so they are created and removed with the kobject and
+ * find the reservation from the kobject. The reservation data is never freed, the directory can be.
+ */
+struct task_dir {
+    struct kobject kobj;
+    struct reservation_data *res_data;
+};
+
+static inline struct reservation_data *kobj_res_data(struct kobject *kobj)
+{
+    return container_of(kobj, struct task_dir, kobj)->res_data;
+}
+
+static ssize_t response_time_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct job_stats *js = &kobj_res_data(kobj)->jobs;
+    unsigned long flags;
+    ssize_t len;
+
+    spin_lock_irqsave(&js->lock, flags);
+    len = hist_show(&js->response_hist, buf);
+    spin_unlock_irqrestore(&js->lock, flags);
+    return len;
+}
+
+static ssize_t release_latency_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct job_stats *js = &kobj_res_data(kobj)->jobs;
+    unsigned long flags;
+    ssize_t len;
+
+    spin_lock_irqsave(&js->lock, flags);
+    len = hist_show(&js->release_hist, buf);
+    spin_unlock_irqrestore(&js->lock, flags);
+    return len;
+}
+
+static ssize_t deadline_misses_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct job_stats *js = &kobj_res_data(kobj)->jobs;
+    unsigned long flags;
+    ssize_t len;
+
+    spin_lock_irqsave(&js->lock, flags);
+    len = scnprintf(buf, PAGE_SIZE, "released %llu\ncompleted %llu\nmissed %llu\n",
+                    js->jobs_released, js->jobs_completed, js->deadline_misses);
+    spin_unlock_irqrestore(&js->lock, flags);
+    return len;
+}
+
+static ssize_t exec_stats_attr_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return exec_stats_show(kobj_res_data(kobj), buf);
+}
+
+static ssize_t profile_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct reservation_data *res_data = kobj_res_data(kobj);
+    const char *state;
+    ssize_t len = 0;
+
+    if (res_data->profiling)
+        state = res_data->profile_done ? "done" : "profiling";
+    else
+        state = "off";
+
+    len += scnprintf(buf + len, PAGE_SIZE - len, "state %s\n", state);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "periods_left %u\n", res_data->profile_periods_left);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "recommended_C_us %llu\n",
+                     div_u64(timespec_to_ns(&res_data->recommended_C), 1000));
+    return len;
+}
+
+static ssize_t util_attr_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return util_show(kobj_res_data(kobj), buf);
+}
+
+static ssize_t energy_attr_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return scnprintf(buf, PAGE_SIZE, "%llu\n", kobj_res_data(kobj)->energy_accumulator);
+}
+
+static ssize_t params_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct reservation_data *res_data = kobj_res_data(kobj);
+    struct reserve_group *group;
+    ssize_t len = 0;
+    int group_id;
+
+    // A group is freed after a grace period of sched RCU, see group.c
+    rcu_read_lock_sched();
+    group = rcu_dereference_sched(res_data->group);
+    group_id = group ? group->id : 0;
+    rcu_read_unlock_sched();
+
+    len += scnprintf(buf + len, PAGE_SIZE - len, "C_us %llu\n", div_u64(timespec_to_ns(&res_data->reserve_C), 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "T_us %llu\n", div_u64(timespec_to_ns(&res_data->reserve_T), 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "D_us %llu\n", div_u64(timespec_to_ns(&res_data->reserve_D), 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "cpu %d\n", res_data->reserve_cpu);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "type %d\n", res_data->reserve_type);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "overrun_policy %d\n", res_data->overrun_policy);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "group %d\n", group_id);
+    return len;
+}
+
+static struct kobj_attribute response_time_attr = __ATTR(response_time, 0444, response_time_show, NULL);
+static struct kobj_attribute release_latency_attr = __ATTR(release_latency, 0444, release_latency_show, NULL);
+static struct kobj_attribute deadline_misses_attr = __ATTR(deadline_misses, 0444, deadline_misses_show, NULL);
+static struct kobj_attribute exec_stats_attr = __ATTR(exec_stats, 0444, exec_stats_attr_show, NULL);
+static struct kobj_attribute profile_attr = __ATTR(profile, 0444, profile_show, NULL);
+static struct kobj_attribute util_attr = __ATTR(util, 0444, util_attr_show, NULL);
+static struct kobj_attribute energy_attr = __ATTR(energy, 0444, energy_attr_show, NULL);
+static struct kobj_attribute params_attr = __ATTR(params, 0444, params_show, NULL);
+
+static struct attribute *task_dir_attrs[] = {
+    &response_time_attr.attr,
+    &release_latency_attr.attr,
+    &deadline_misses_attr.attr,
+    &exec_stats_attr.attr,
+    &profile_attr.attr,
+    &util_attr.attr,
+    &energy_attr.attr,
+    &params_attr.attr,
+    NULL,
+};
+
+static void task_dir_release(struct kobject *kobj)
+{
+    kfree(container_of(kobj, struct task_dir, kobj));
+}
+
+static struct kobj_type task_dir_ktype = {
+    .release = task_dir_release,
+    .sysfs_ops = &kobj_sysfs_ops,
+    .default_attrs = task_dir_attrs,
+};
+
+// Create the /sys/rtes/tasks/<pid> directory with its files
+int create_task_dir(struct task_struct *task)
+{
+    struct reservation_data *res_data = task->reservation_data;
+    struct task_dir *dir;
+    int ret;
+
+    if (res_data->task_kobj)
+        return 0; // Already exists
+
+    if (!tasks_kobj) {
+        printk(KERN_ERR "create_task_dir: /sys/rtes/tasks is not initialized yet!\n");
+        return -EINVAL;
+    }
+
+    dir = kzalloc(sizeof(*dir), GFP_KERNEL);
+    if (!dir)
+        return -ENOMEM;
+    dir->res_data = res_data;
+
+    ret = kobject_init_and_add(&dir->kobj, &task_dir_ktype, tasks_kobj, "%d", task->pid);
+    if (ret) {
+        printk(KERN_ERR "create_task_dir: Failed to create /sys/rtes/tasks/%d\n", task->pid);
+        kobject_put(&dir->kobj);
+        return ret;
+    }
+    res_data->task_kobj = &dir->kobj;
+    return 0;
+}
+
+// Remove /sys/rtes/tasks/<pid>, a read in progress is waited for by sysfs
+void remove_task_dir(struct task_struct *task)
+{
+    struct reservation_data *res_data = task->reservation_data;
+
+    if (!res_data || !res_data->task_kobj)
+        return;
+
+    kobject_del(res_data->task_kobj);
+    kobject_put(res_data->task_kobj);
+    res_data->task_kobj = NULL;
+}
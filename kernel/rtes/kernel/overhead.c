@@ -0,0 +1,160 @@
+/**
+ * Overhead-aware admission
+ *  Every job of a reservation costs kernel time that is not part of its C: the replenishment timer that
+ *  releases the job and wakes the thread, and the context switches into and out of it. At periods of a few
+ *  ms this is a noticeable share of the cpu, and a cpu admitted close to its bound misses deadlines. Both
+ *  are measured on each cpu while the reservations run:
+ *   - timer: duration of reservation_timer_callback, including the wakeup of a throttled thread
+ *   - switch: from the accounting hook of context_switch to finish_task_switch, for the switches into or
+ *     out of a thread with a reservation
+ *  The entry and exit of the timer interrupt are not seen, so both are lower bounds.
+ *
+ *  With /sys/rtes/config/overhead_aware = 1 the admission test takes C' = C + timer + 2 * switch for every
+ *  task of a cpu, with the largest values measured on that cpu (on any cpu for global reservations). The
+ *  preemption of a job is covered by the two switches of the preempting job. Nothing is added on a cpu
+ *  that has not run a reservation yet.
+ *
+ *  /sys/rtes/overhead lists every cpu that measured something:
+ *   CPU TIMERS TIMER_AVG_NS TIMER_MAX_NS SWITCHES SWITCH_AVG_NS SWITCH_MAX_NS
+ *  with averages that move by 1/8 of every sample. Writing 0 to it starts the measurements over, e.g. once
+ *  the caches are warm.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/reservation.h>
+#include "taskmon.h"
+
+// Only written by its own cpu with irqs off, u32 so that readers on other cpus never see half a value
+struct rtes_overhead {
+    unsigned long timers;
+    u32 timer_avg_ns;
+    u32 timer_max_ns;
+    unsigned long switches;
+    u32 switch_avg_ns;
+    u32 switch_max_ns;
+    u64 switch_start_ns;        // local_clock() at the accounting hook of the switch in progress, 0 if none
+};
+
+static DEFINE_PER_CPU(struct rtes_overhead, rtes_overheads);
+
+unsigned int overhead_aware = 0;
+
+static void overhead_add(unsigned long *n, u32 *avg, u32 *max, u64 ns)
+{
+    u32 sample = min_t(u64, ns, ~0U);
+
+    *avg = (*n)++ ? *avg - (*avg >> 3) + (sample >> 3) : sample;
+    if (sample > *max)
+        *max = sample;
+}
+
+// Called at the end of reservation_timer_callback, start_ns is local_clock() at its start
+void overhead_timer(u64 start_ns)
+{
+    struct rtes_overhead *ov = &__get_cpu_var(rtes_overheads);
+
+    overhead_add(&ov->timers, &ov->timer_avg_ns, &ov->timer_max_ns, local_clock() - start_ns);
+}
+
+// Called by context_switch with the rq lock held, reserved if prev or next has a reservation
+void overhead_switch_begin(bool reserved)
+{
+    __get_cpu_var(rtes_overheads).switch_start_ns = reserved ? local_clock() : 0;
+}
+
+// Called by finish_task_switch in the thread switched to, also after a fork
+void overhead_switch_end(void)
+{
+    struct rtes_overhead *ov = &__get_cpu_var(rtes_overheads);
+
+    if (!ov->switch_start_ns)
+        return;
+    overhead_add(&ov->switches, &ov->switch_avg_ns, &ov->switch_max_ns, local_clock() - ov->switch_start_ns);
+    ov->switch_start_ns = 0;
+}
+
+static u64 overhead_cpu_job_ns(int cpu)
+{
+    struct rtes_overhead *ov = &per_cpu(rtes_overheads, cpu);
+
+    return (u64)ACCESS_ONCE(ov->timer_max_ns) + 2 * (u64)ACCESS_ONCE(ov->switch_max_ns);
+}
+
+// Kernel time a job of a reservation on cpuid is charged by the admission test, 0 unless overhead_aware
+u64 overhead_job_ns(int cpuid)
+{
+    u64 ns = 0;
+    int cpu;
+
+    if (!overhead_aware)
+        return 0;
+    if (cpuid != RTES_GLOBAL_CPU)
+        return rtes_cpu_valid(cpuid) ? overhead_cpu_job_ns(cpuid) : 0;
+
+    for_each_possible_cpu(cpu)
+        ns = max(ns, overhead_cpu_job_ns(cpu));
+    return ns;
+}
+
+static ssize_t overhead_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct rtes_overhead *ov;
+    ssize_t len;
+    int cpu;
+
+    len = scnprintf(buf, PAGE_SIZE, "CPU TIMERS TIMER_AVG_NS TIMER_MAX_NS SWITCHES SWITCH_AVG_NS SWITCH_MAX_NS\n");
+    for_each_possible_cpu(cpu) {
+        ov = &per_cpu(rtes_overheads, cpu);
+        if (!ov->timers && !ov->switches)
+            continue;
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%d %lu %u %u %lu %u %u\n", cpu,
+                         ov->timers, ov->timer_avg_ns, ov->timer_max_ns,
+                         ov->switches, ov->switch_avg_ns, ov->switch_max_ns);
+    }
+    return len;
+}
+
+static ssize_t overhead_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct rtes_overhead *ov;
+    unsigned int value;
+    int cpu, ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value != 0)
+        return -EINVAL;
+
+    // Racing with the cpus only loses a sample or keeps one from before
+    for_each_possible_cpu(cpu) {
+        ov = &per_cpu(rtes_overheads, cpu);
+        ov->timers = 0;
+        ov->timer_avg_ns = 0;
+        ov->timer_max_ns = 0;
+        ov->switches = 0;
+        ov->switch_avg_ns = 0;
+        ov->switch_max_ns = 0;
+    }
+    return count;
+}
+
+static struct kobj_attribute overhead_attr = __ATTR(overhead, 0664, overhead_show, overhead_store);
+
+static int __init overhead_init(void)
+{
+    if (!rtes_kobj)
+        return -ENOMEM;
+    if (sysfs_create_file(rtes_kobj, &overhead_attr.attr)) {
+        printk(KERN_ERR "Failed to create file: /sys/rtes/overhead\n");
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+// Use postcore so that it runs after rtes_kobj is initialized by taskmon
+postcore_initcall(overhead_init);
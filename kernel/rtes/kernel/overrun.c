@@ -0,0 +1,232 @@
+/**
+ * Overrun policies
+ *  What happens when a periodic reservation uses up its budget, set per reservation with
+ *  set_overrun_policy(pid, policy) once the reservation is set:
+ *   - RTES_OVERRUN_THROTTLE: the thread is suspended until its next release (default)
+ *   - RTES_OVERRUN_SIGNAL: suspended as well, and SIGEXCESS is queued with the overrun in ns in si_int,
+ *     so the handler runs as soon as the thread is released again
+ *   - RTES_OVERRUN_DEMOTE: the thread runs on as SCHED_OTHER until its next release
+ *   - RTES_OVERRUN_BORROW: the thread runs on with up to one more budget C taken from its next job, which
+ *     is shortened by what was used. A job can then run for up to 2C, so the admission test charges such
+ *     a reservation 2C, and the policy is only set if its cpu still passes with that.
+ *
+ *  The overrun is detected in context_switch with the rq lock held, where a signal cannot be sent and the
+ *  scheduling class cannot be changed. The signal goes out from an irq_work with a sigqueue allocated when
+ *  the policy is set, so nothing is allocated on that path. The demotion is done by a work item since
+ *  sched_setscheduler cannot be called from interrupt context, and the thread stays suspended until then.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/signal.h>
+#include <linux/irq_work.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/reservation.h>
+
+// Queue SIGEXCESS, the sigqueue is only touched here and while it is on the pending list of the thread
+static void overrun_irq_work_fn(struct irq_work *work)
+{
+    struct reservation_data *res_data = container_of(work, struct reservation_data, overrun_irq_work);
+    struct task_struct *task = res_data->task;
+    struct sigqueue *q = res_data->overrun_sigq;
+    unsigned long flags;
+    bool queued;
+
+    if (res_data->overrun_policy == RTES_OVERRUN_DEMOTE) {
+        schedule_work(&res_data->overrun_work);
+        return;
+    }
+    if (res_data->overrun_policy != RTES_OVERRUN_SIGNAL || !q)
+        return;
+
+    if (!lock_task_sighand(task, &flags))
+        return; // Exiting
+    queued = !list_empty(&q->list);
+    unlock_task_sighand(task, &flags);
+
+    // A SIGEXCESS not handled yet already tells the thread about the overrun
+    if (queued)
+        return;
+
+    q->info.si_signo = SIGEXCESS;
+    q->info.si_errno = 0;
+    q->info.si_code = SI_QUEUE;
+    q->info.si_pid = 0;
+    q->info.si_uid = 0;
+    q->info.si_int = min_t(u64, res_data->overrun_ns, INT_MAX);
+    send_sigqueue(q, task, 0);
+}
+
+// Move the thread to SCHED_OTHER or back to its rt priority, whichever res_data->demoted asks for
+static void overrun_work_fn(struct work_struct *work)
+{
+    struct reservation_data *res_data = container_of(work, struct reservation_data, overrun_work);
+    struct task_struct *task = res_data->task;
+    struct sched_param param;
+
+    if (res_data->demoted && task->policy != SCHED_NORMAL) {
+        param.sched_priority = 0;
+        sched_setscheduler_nocheck(task, SCHED_NORMAL, &param);
+        // Only the suspension of overrun_handle ends here, not any other sleep of the thread
+        if (xchg(&res_data->demote_suspended, false))
+            wake_up_process(task);
+    } else if (!res_data->demoted && res_data->has_reservation && task->policy == SCHED_NORMAL &&
+               res_data->demoted_policy != SCHED_NORMAL) {
+        param.sched_priority = res_data->demoted_prio;
+        sched_setscheduler_nocheck(task, res_data->demoted_policy, &param);
+    }
+}
+
+// Called once when the reservation data is created
+void overrun_init(struct reservation_data *res_data)
+{
+    init_irq_work(&res_data->overrun_irq_work, overrun_irq_work_fn);
+    INIT_WORK(&res_data->overrun_work, overrun_work_fn);
+    res_data->overrun_policy = RTES_OVERRUN_THROTTLE;
+    res_data->demoted_policy = SCHED_NORMAL;
+}
+
+// Change the policy of a reservation, in process context
+int overrun_set_policy(struct reservation_data *res_data, int policy)
+{
+    if (policy < 0 || policy >= RTES_OVERRUN_MAX)
+        return -EINVAL;
+
+    // The sigqueue lives as long as the thread, see overrun_exit
+    if (policy == RTES_OVERRUN_SIGNAL && !res_data->overrun_sigq) {
+        res_data->overrun_sigq = sigqueue_alloc();
+        if (!res_data->overrun_sigq)
+            return -ENOMEM;
+        memset(&res_data->overrun_sigq->info, 0, sizeof(siginfo_t));
+    }
+
+    overrun_stop(res_data);
+    res_data->overrun_policy = policy;
+    return 0;
+}
+
+// Count an overrun of the current job and report it, see events.c
+static void overrun_count(struct reservation_data *res_data, u64 budget_ns)
+{
+    res_data->overruns++;
+    rtes_event(RTES_EVENT_OVERRUN, res_data->task, res_data->reserve_cpu,
+               res_data->exec_accumulated_time - min(res_data->exec_accumulated_time, budget_ns));
+}
+
+/**
+ * Called from context_switch when prev used up budget_ns, with the rq lock held
+ * Returns true if the thread has to be suspended.
+ */
+bool overrun_handle(struct reservation_data *res_data, u64 budget_ns)
+{
+    struct task_struct *task = res_data->task;
+
+    switch (res_data->overrun_policy) {
+    case RTES_OVERRUN_SIGNAL:
+        if (!res_data->overrun_signalled) {
+            res_data->overrun_signalled = true;     // Once per job
+            res_data->overrun_ns = res_data->exec_accumulated_time - budget_ns;
+            overrun_count(res_data, budget_ns);
+            irq_work_queue(&res_data->overrun_irq_work);
+        }
+        return true;
+
+    case RTES_OVERRUN_DEMOTE:
+        if (res_data->demoted || res_data->overrun_signalled)
+            return false;
+        res_data->overrun_signalled = true;     // Once per job
+        overrun_count(res_data, budget_ns);
+        if (task->policy != SCHED_FIFO && task->policy != SCHED_RR)
+            return false;   // Not running with an rt priority anyway
+        res_data->demoted = true;
+        res_data->demote_suspended = true;
+        res_data->demoted_policy = task->policy;
+        res_data->demoted_prio = task->rt_priority;
+        irq_work_queue(&res_data->overrun_irq_work);
+        return true;
+
+    case RTES_OVERRUN_BORROW:
+        if (!res_data->split.parts &&
+            res_data->exec_accumulated_time < budget_ns + timespec_to_ns(&res_data->reserve_C)) {
+            if (!res_data->overrun_signalled) {
+                res_data->overrun_signalled = true;
+                overrun_count(res_data, budget_ns);
+            }
+            return false;
+        }
+        return true;
+
+    default:
+        overrun_count(res_data, budget_ns);
+        return true;
+    }
+}
+
+// Budget of a job the admission test charges for the reservation, see RTES_OVERRUN_BORROW
+u64 overrun_admitted_ns(struct reservation_data *res_data)
+{
+    u64 budget_ns = timespec_to_ns(&res_data->reserve_C);
+
+    if (res_data->overrun_policy == RTES_OVERRUN_BORROW && !res_data->split.parts)
+        return 2 * budget_ns;
+    return budget_ns;
+}
+
+/**
+ * New period, called by the replenishment timer with the execution time exec_ns of the last job
+ * A borrowing job passes what it used beyond its budget on to the next one as debt, a demoted thread
+ * gets its rt priority back.
+ */
+void overrun_release(struct reservation_data *res_data, u64 exec_ns)
+{
+    u64 budget_ns = timespec_to_ns(&res_data->reserve_C);
+    u64 job_budget_ns = budget_ns - min(budget_ns, res_data->overrun_debt_ns);
+
+    // A holder that ran on while boosted pays it back the same way, see blocking.c
+    if ((res_data->overrun_policy == RTES_OVERRUN_BORROW || res_data->pi_borrowed) && exec_ns > job_budget_ns)
+        res_data->overrun_debt_ns = min(exec_ns - job_budget_ns, budget_ns);
+    else
+        res_data->overrun_debt_ns = 0;
+
+    res_data->pi_borrowed = false;
+    res_data->overrun_signalled = false;
+    res_data->demote_suspended = false;    // Woken by the replenishment timer
+    if (res_data->demoted) {
+        res_data->demoted = false;
+        schedule_work(&res_data->overrun_work);
+    }
+}
+
+// Back to the throttle policy state when the reservation is reset, cancelled or the thread exits
+void overrun_stop(struct reservation_data *res_data)
+{
+    struct sched_param param;
+
+    irq_work_sync(&res_data->overrun_irq_work);
+    cancel_work_sync(&res_data->overrun_work);
+
+    if (res_data->demoted && res_data->task->policy == SCHED_NORMAL &&
+        res_data->demoted_policy != SCHED_NORMAL) {
+        param.sched_priority = res_data->demoted_prio;
+        sched_setscheduler_nocheck(res_data->task, res_data->demoted_policy, &param);
+    }
+    res_data->demoted = false;
+    res_data->demote_suspended = false;
+    res_data->overrun_signalled = false;
+    res_data->overrun_debt_ns = 0;
+    res_data->pi_borrowed = false;
+    res_data->overrun_policy = RTES_OVERRUN_THROTTLE;
+}
+
+/**
+ * Free the sigqueue, called by the exiting thread itself
+ * sigqueue_free locks the sighand of current, so it cannot be done by cancel_reserve from another process.
+ */
+void overrun_exit(struct reservation_data *res_data)
+{
+    if (res_data->overrun_sigq) {
+        sigqueue_free(res_data->overrun_sigq);
+        res_data->overrun_sigq = NULL;
+    }
+}
@@ -0,0 +1,175 @@
+/**
+ * /proc/rtes
+ *  reserves: one line per reserved thread
+ *   TID PID PRIO CPU C_US T_US D_US UTIL USED_US OVERRUNS TYPE POLICY ENERGY_MJ NAME
+ *   with UTIL = C / T in percent, USED_US the budget used in the current period and POLICY the overrun policy
+ *  reserves_bin: the same as an array of struct rtes_reserve_info, for tools
+ *
+ *  Both are streamed with seq_file over reserved_tasks_list under RCU, so they have no size limit and
+ *  reading them never holds up admission. A thread whose reservation changes while it is listed may show a
+ *  mix of its old and new parameters.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/rculist.h>
+#include <linux/math64.h>
+#include <linux/reservation.h>
+
+static const char * const reserve_type_names[RESERVE_TYPE_MAX] = {
+    [RESERVE_PERIODIC] = "periodic",
+    [RESERVE_CBS] = "cbs",
+};
+
+static const char * const overrun_policy_names[RTES_OVERRUN_MAX] = {
+    [RTES_OVERRUN_THROTTLE] = "throttle",
+    [RTES_OVERRUN_SIGNAL] = "signal",
+    [RTES_OVERRUN_DEMOTE] = "demote",
+    [RTES_OVERRUN_BORROW] = "borrow",
+};
+
+// Snapshot of the reservation of node->task
+static void reserve_info(struct reserved_task *node, struct rtes_reserve_info *info)
+{
+    struct task_struct *task = node->task;
+    struct reservation_data *res_data = task->reservation_data;
+
+    memset(info, 0, sizeof(*info));
+    info->tid = task->pid;
+    info->pid = task->tgid;
+    info->priority = task->rt_priority;
+    info->cpu = res_data->reserve_cpu;
+    info->C_ns = timespec_to_ns(&res_data->reserve_C);
+    info->T_ns = timespec_to_ns(&res_data->reserve_T);
+    info->D_ns = timespec_to_ns(&res_data->reserve_D);
+    info->used_ns = res_data->exec_accumulated_time;
+    info->overruns = res_data->overruns;
+    info->energy_mj = res_data->energy_accumulator;
+    info->util = info->T_ns ? div64_u64(info->C_ns * 1000, info->T_ns) : 0;
+    info->type = res_data->reserve_type;
+    info->overrun_policy = res_data->overrun_policy;
+    get_task_comm(info->name, task);
+}
+
+static void *reserves_seq_start(struct seq_file *m, loff_t *pos)
+    __acquires(RCU)
+{
+    struct reserved_task *node;
+    loff_t n = *pos;
+
+    rcu_read_lock();
+    if (n == 0)
+        return SEQ_START_TOKEN;
+    list_for_each_entry_rcu(node, &reserved_tasks_list, list) {
+        if (--n == 0)
+            return node;
+    }
+    return NULL;
+}
+
+static void *reserves_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+    struct list_head *next;
+
+    ++*pos;
+    if (v == SEQ_START_TOKEN)
+        next = rcu_dereference(list_next_rcu(&reserved_tasks_list));
+    else
+        next = rcu_dereference(list_next_rcu(&((struct reserved_task *)v)->list));
+    return next == &reserved_tasks_list ? NULL : list_entry(next, struct reserved_task, list);
+}
+
+static void reserves_seq_stop(struct seq_file *m, void *v)
+    __releases(RCU)
+{
+    rcu_read_unlock();
+}
+
+static int reserves_seq_show(struct seq_file *m, void *v)
+{
+    struct rtes_reserve_info info;
+
+    if (v == SEQ_START_TOKEN) {
+        seq_printf(m, "  TID   PID PRIO CPU       C_US       T_US       D_US  UTIL    USED_US OVERRUNS "
+                      "TYPE     POLICY   ENERGY_MJ NAME\n");
+        return 0;
+    }
+
+    reserve_info(v, &info);
+    seq_printf(m, "%5d %5d %4u %3d %10llu %10llu %10llu %3u.%u %10llu %8llu %-8s %-8s %9llu %s\n",
+               info.tid, info.pid, info.priority, info.cpu, div_u64(info.C_ns, NSEC_PER_USEC),
+               div_u64(info.T_ns, NSEC_PER_USEC), div_u64(info.D_ns, NSEC_PER_USEC), info.util / 10,
+               info.util % 10, div_u64(info.used_ns, NSEC_PER_USEC), info.overruns,
+               info.type < RESERVE_TYPE_MAX ? reserve_type_names[info.type] : "?",
+               info.overrun_policy < RTES_OVERRUN_MAX ? overrun_policy_names[info.overrun_policy] : "?",
+               info.energy_mj, info.name);
+    return 0;
+}
+
+static int reserves_bin_seq_show(struct seq_file *m, void *v)
+{
+    struct rtes_reserve_info info;
+
+    if (v == SEQ_START_TOKEN)
+        return 0;
+
+    reserve_info(v, &info);
+    return seq_write(m, &info, sizeof(info));
+}
+
+static const struct seq_operations reserves_seq_ops = {
+    .start = reserves_seq_start,
+    .next = reserves_seq_next,
+    .stop = reserves_seq_stop,
+    .show = reserves_seq_show,
+};
+
+static const struct seq_operations reserves_bin_seq_ops = {
+    .start = reserves_seq_start,
+    .next = reserves_seq_next,
+    .stop = reserves_seq_stop,
+    .show = reserves_bin_seq_show,
+};
+
+static int reserves_open(struct inode *inode, struct file *file)
+{
+    return seq_open(file, &reserves_seq_ops);
+}
+
+static int reserves_bin_open(struct inode *inode, struct file *file)
+{
+    return seq_open(file, &reserves_bin_seq_ops);
+}
+
+static const struct file_operations reserves_fops = {
+    .open = reserves_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = seq_release,
+};
+
+static const struct file_operations reserves_bin_fops = {
+    .open = reserves_bin_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = seq_release,
+};
+
+static int __init rtes_proc_init(void)
+{
+    struct proc_dir_entry *dir;
+
+    dir = proc_mkdir("rtes", NULL);
+    if (!dir)
+        return -ENOMEM;
+    if (!proc_create("reserves", 0444, dir, &reserves_fops) ||
+        !proc_create("reserves_bin", 0444, dir, &reserves_bin_fops)) {
+        printk(KERN_ERR "rtes: /proc/rtes creation failed\n");
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+fs_initcall(rtes_proc_init);
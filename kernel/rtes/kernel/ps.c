@@ -8,6 +8,14 @@
  * Add a new system call count_rt_threads that can be used to obtain an 
  * integer value that equals the total number of real-time threads that 
  * currently exist in the system (see Section 2.4).
+ *
+ * Threads with rt_priority > 0 are counted where rt_priority changes instead of by walking every
+ * thread: fork counts the child when its pid is attached and sets task->rt_accounted,
+ * __setscheduler moves a thread between priorities only while it is set, and __unhash_process
+ * uncounts it when the pid is detached. A child still has the pids of its parent before that, so
+ * pid_alive cannot tell. The counts are kept per cpu like process_counts, with irqs off, and summed
+ * when read. /sys/rtes/rt_prio_counts shows them
+ * per priority.
  */
 
 #include <linux/kernel.h>
@@ -17,84 +25,242 @@
 #include <linux/types.h>
 #include <linux/uaccess.h>
 #include <linux/list.h>
+#include <linux/percpu.h>
+#include <linux/module.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/slab.h>
+#include <linux/pid_namespace.h>
+#include <linux/reservation.h>
+#include "taskmon.h"
 
+// Threads that entered minus threads that left, per rt priority, on one cpu
+struct rt_thread_counts {
+    long total;
+    long prio[MAX_RT_PRIO];
+};
+
+static DEFINE_PER_CPU(struct rt_thread_counts, rt_thread_counts);
+
+// Changes of the set of rt threads or of their priorities, see list_rt_threads_ex
+static atomic_t rt_generation = ATOMIC_INIT(0);
+
+// task moves from rt priority old_prio to new_prio, 0 being no rt priority. Called with irqs off.
+void rt_threads_account(struct task_struct *task, unsigned int old_prio, unsigned int new_prio)
+{
+    struct rt_thread_counts *counts = &__get_cpu_var(rt_thread_counts);
+
+    if (old_prio == new_prio)
+        return;
+    atomic_inc(&rt_generation);
+    rt_watch_record(task, old_prio, new_prio);
+    if (old_prio > 0 && old_prio < MAX_RT_PRIO) {
+        counts->total--;
+        counts->prio[old_prio]--;
+    }
+    if (new_prio > 0 && new_prio < MAX_RT_PRIO) {
+        counts->total++;
+        counts->prio[new_prio]++;
+    }
+}
+
+unsigned int rt_threads_generation(void)
+{
+    return atomic_read(&rt_generation);
+}
+
+// Number of threads with an rt priority
+long nr_rt_threads(void)
+{
+    long total = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        total += per_cpu(rt_thread_counts, cpu).total;
+    return max(total, 0L);  // The sum is not atomic
+}
+
+// Number of threads at rt priority prio
+long nr_rt_threads_prio(unsigned int prio)
+{
+    long total = 0;
+    int cpu;
+
+    if (prio == 0 || prio >= MAX_RT_PRIO)
+        return 0;
+    for_each_possible_cpu(cpu)
+        total += per_cpu(rt_thread_counts, cpu).prio[prio];
+    return max(total, 0L);
+}
 
 SYSCALL_DEFINE0(count_rt_threads) {
-    struct task_struct *task, *t;       // task handle process,  t handle thread
-    int num_rt_threads = 0;
-    rcu_read_lock(); // Start the read-side critical section
-
-    // Loop thru all processes
-    do_each_thread(task, t) {
-        if (t->rt_priority > 0) {       // only count real-time threads
-            num_rt_threads++; 
-        }
-    } while_each_thread(task, t);
-    
-    rcu_read_unlock(); // End the read-side critical section 
-    return num_rt_threads;
+    return nr_rt_threads();
+}
+
+// "<prio> <threads>" for every rt priority in use, highest first
+static ssize_t rt_prio_counts_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    ssize_t len = 0;
+    long n;
+    int prio;
+
+    for (prio = MAX_RT_PRIO - 1; prio > 0; prio--) {
+        n = nr_rt_threads_prio(prio);
+        if (n)
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%d %ld\n", prio, n);
+    }
+    return len;
 }
 
+static struct kobj_attribute rt_prio_counts_attr = __ATTR(rt_prio_counts, 0444, rt_prio_counts_show, NULL);
+
+static int __init rt_thread_counts_init(void)
+{
+    if (!rtes_kobj)
+        return -ENOMEM;
+    if (sysfs_create_file(rtes_kobj, &rt_prio_counts_attr.attr)) {
+        printk(KERN_ERR "Failed to create file: /sys/rtes/rt_prio_counts\n");
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+// Use postcore so that it runs after rtes_kobj is initialized by taskmon
+postcore_initcall(rt_thread_counts_init);
+
 
 /**
  * Add a new system call list_rt_threads that can be used to obtain a 
  * data structure with the list of real-time threads that currently 
  * exist in the system. The following attributes should be available for each
  * thread: TID, PID, real-time priority and name (command).
+ *
+ * Threads are listed in tid order, a batch at a time: the batch is filled in a kernel buffer under
+ * rcu_read_lock and copied to userspace once the lock is dropped. list_rt_threads_ex takes a cursor
+ * to resume from and returns the rt generation, so a caller can page through any number of threads
+ * and skip the listing when the generation did not change since the last one.
  */
-struct rt_thread {
-    pid_t tid;      /* Thread ID */
-    pid_t pid;      /* Process ID */
-    int priority;   /* Thread Priority */ 
-    char name[20];     /* Name (command) */ 
-};
+// Threads listed by one call of list_rt_threads_ex
+#define RT_LIST_BATCH 256
 
-SYSCALL_DEFINE2 (list_rt_threads, struct __user rt_thread *, rt_thread_list, unsigned int, num_threads) {
-    struct task_struct *task, *t;       // task handle process,  t handle thread
+/**
+ * Index of the rt threads of ns in tid order, used by the listings here and by psdev
+ * Returns the first rt thread with a tid >= *tid and sets *tid to its tid, or NULL if there is none.
+ * Called under rcu_read_lock, the thread is only valid until it is dropped.
+ */
+struct task_struct *rt_thread_next(struct pid_namespace *ns, pid_t *tid)
+{
+    struct task_struct *t;
+    struct pid *pid;
+    pid_t nr = max(*tid, 1);
+
+    while ((pid = find_ge_pid(nr, ns))) {
+        nr = pid_nr_ns(pid, ns);
+        t = pid_task(pid, PIDTYPE_PID);
+        if (t && t->rt_priority > 0) {
+            *tid = nr;
+            return t;
+        }
+        nr++;
+    }
+    return NULL;
+}
+EXPORT_SYMBOL(rt_thread_next);
+
+// Fill batch with up to n rt threads from tid from on, *next is the tid to resume from or 0 at the end
+static int collect_rt_threads(pid_t from, struct rt_thread_info *batch, unsigned int n, pid_t *next)
+{
+    struct pid_namespace *ns = task_active_pid_ns(current);
+    struct reservation_data *res_data;
+    struct task_struct *t;
+    pid_t nr = from;
     int i = 0;
+
+    *next = 0;
+    rcu_read_lock();
+    while ((t = rt_thread_next(ns, &nr))) {
+        if (i == n) {
+            *next = nr;
+            break;
+        }
+        memset(&batch[i], 0, sizeof(batch[i]));
+        batch[i].tid = nr;
+        batch[i].pid = task_tgid_nr_ns(t, ns);
+        batch[i].priority = t->rt_priority;
+        batch[i].policy = t->policy;
+        batch[i].cpu = task_cpu(t);
+        batch[i].reserve_cpu = -1;
+        res_data = t->reservation_data;     // Never freed once set
+        if (res_data && res_data->has_reservation) {
+            batch[i].reserved = 1;
+            batch[i].reserve_cpu = res_data->reserve_cpu;
+            batch[i].C_us = div_u64(timespec_to_ns(&res_data->reserve_C), NSEC_PER_USEC);
+            batch[i].T_us = div_u64(timespec_to_ns(&res_data->reserve_T), NSEC_PER_USEC);
+        }
+        get_task_comm(batch[i].name, t);
+        i++;
+        nr++;
+    }
+    rcu_read_unlock();
+    return i;
+}
+
+SYSCALL_DEFINE2 (list_rt_threads, struct __user rt_thread *, rt_thread_list, unsigned int, num_threads) {
+    struct rt_thread_info *batch;
     struct rt_thread rt_info;
+    unsigned int i = 0;
+    pid_t from = 0, next;
+    int n, k;
+
+    batch = kmalloc(sizeof(*batch) * RT_LIST_BATCH, GFP_KERNEL);
+    if (!batch)
+        return -ENOMEM;
 
-    rcu_read_lock(); // Start the read-side critical section
-    printk(KERN_INFO "ps: HERE 0\n");
-
-    // Loop thru all processes
-    for_each_process(task) {
-        t = task;
-        do {
-            if (t->rt_priority > 0) {
-                if (i > num_threads) {
-                    printk(KERN_WARNING "ps: Thread list reached desired list size\n");
-                    break; // Exit, reached desired list size
-                }
-
-                rt_info.tid = t->pid;
-                rt_info.pid = task->tgid;
-                rt_info.priority = t->rt_priority;
-                strncpy(rt_info.name, t->comm, 20);
-                rt_info.name[19] = '\0'; // Ensure null-terminated string
-
-                // Print the data being copied for debugging
-                printk(KERN_INFO "ps: Copying thread info to user space:\n");
-                printk(KERN_INFO "ps: tid = %d, pid = %d, priority = %d, name = %s\n", 
-                        rt_info.tid, rt_info.pid, rt_info.priority, rt_info.name);
-
-                // Print destination user-space pointer info for debugging
-                printk(KERN_INFO "ps: Destination rt_thread_list[%d] = %p, copying size = %u bytes\n",
-                        i, &rt_thread_list[i], sizeof(struct rt_thread));
-
-
-                // unsigned long copy_to_user (void __user * to, const void * from, unsigned long n);
-                if (copy_to_user(rt_thread_list + i, &rt_info, sizeof(struct rt_thread))) {
-                    printk(KERN_WARNING "ps: Error copying thread info to user space\n");
-                    rcu_read_unlock();
-                    return -EFAULT;
-                }
-                i++;
+    do {
+        n = collect_rt_threads(from, batch, min_t(unsigned int, num_threads - i, RT_LIST_BATCH), &next);
+        for (k = 0; k < n; k++, i++) {
+            memset(&rt_info, 0, sizeof(rt_info));
+            rt_info.tid = batch[k].tid;
+            rt_info.pid = batch[k].pid;
+            rt_info.priority = batch[k].priority;
+            strlcpy(rt_info.name, batch[k].name, sizeof(rt_info.name));
+            if (copy_to_user(rt_thread_list + i, &rt_info, sizeof(struct rt_thread))) {
+                kfree(batch);
+                return -EFAULT;
             }
-            t = next_thread(t);
-        } while(t != task);
-    }
- 
-    rcu_read_unlock(); // End the read-side critical section 
+        }
+        from = next;
+    } while (next && i < num_threads);
+
+    kfree(batch);
     return i;
-}
\ No newline at end of file
+}
+
+/**
+ * List up to n rt threads from cursor->next_tid on, see struct rt_list_cursor
+ * Returns the number of threads copied to list.
+ */
+SYSCALL_DEFINE3(list_rt_threads_ex, struct rt_thread_info __user *, list, unsigned int, n,
+                struct rt_list_cursor __user *, cursor) {
+    struct rt_thread_info *batch;
+    struct rt_list_cursor cur;
+    int ret;
+
+    if (copy_from_user(&cur, cursor, sizeof(cur)))
+        return -EFAULT;
+    if (cur.next_tid < 0)
+        return -EINVAL;
+    n = min_t(unsigned int, n, RT_LIST_BATCH);
+
+    batch = kmalloc(sizeof(*batch) * max(n, 1U), GFP_KERNEL);
+    if (!batch)
+        return -ENOMEM;
+
+    cur.generation = rt_threads_generation();
+    ret = collect_rt_threads(cur.next_tid, batch, n, &cur.next_tid);
+
+    if (copy_to_user(list, batch, sizeof(*batch) * ret) || copy_to_user(cursor, &cur, sizeof(cur)))
+        ret = -EFAULT;
+    kfree(batch);
+    return ret;
+}
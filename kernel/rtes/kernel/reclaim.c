@@ -0,0 +1,228 @@
+/**
+ * Bandwidth reclaiming
+ *  With /sys/rtes/config/reclaiming = 1, the budget a periodic reservation leaves unused when its job ends
+ *  early (end_job) is not lost: it goes to the slack pool of its cpu until the deadline of that job, and a
+ *  reservation of the same cpu that runs out of budget before then keeps running on it instead of being
+ *  throttled. A throttled reservation is woken when slack it may use is donated.
+ *
+ *  The donated time was already accounted for the donor by the admission test, so handing it out keeps the
+ *  guarantees of all other reservations as long as
+ *   - it is used before the donor's absolute deadline (release + D)
+ *   - RM: it goes to reservations whose priority is not above the donor's, which then cause no more
+ *     interference to any task than the donor would have
+ *   - EDF: it goes to reservations whose current deadline is not before the donor's
+ *  Slack nobody takes leaves the cpu to the threads without reservation, as before.
+ *
+ *  Only partitioned periodic reservations donate and reclaim. CBS, split and global reservations and
+ *  profiling threads are not affected.
+ *
+ *  Slack is only donated by end_job, the one point where the thread says its job is done. A thread that
+ *  blocks may still need its budget when it wakes up within the same job, and idle time of the cpu is not
+ *  handed out either, so a job that never calls end_job donates nothing.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/reservation.h>
+
+// Donors of a cpu with slack left
+struct reclaim_pool {
+    spinlock_t lock;
+    struct list_head donors;
+};
+
+static DEFINE_PER_CPU(struct reclaim_pool, reclaim_pools);
+
+unsigned int reclaiming = 0;
+
+
+static bool reclaim_capable(struct reservation_data *res_data)
+{
+    return res_data->reserve_type == RESERVE_PERIODIC && !res_data->split.parts && !res_data->group &&
+           !res_data->profiling && rtes_cpu_valid(res_data->reserve_cpu);
+}
+
+// Whether res_data may use the slack of donor without hurting any other reservation
+static bool reclaim_eligible(struct reservation_data *donor, struct reservation_data *res_data)
+{
+    if (donor == res_data)
+        return false;
+    if (res_data->edf)
+        return donor->reclaim_expires_ns <= res_data->edf_deadline_ns;
+    return res_data->task->rt_priority <= donor->reclaim_prio;
+}
+
+/**
+ * Move the slack res_data may use from the pool of its cpu to its reclaimed budget
+ * Returns true if any slack was taken.
+ */
+static bool reclaim_take(struct reservation_data *res_data, u64 now)
+{
+    struct reclaim_pool *pool = &per_cpu(reclaim_pools, res_data->reserve_cpu);
+    struct reservation_data *donor, *tmp;
+    unsigned long flags;
+    bool taken = false;
+
+    spin_lock_irqsave(&pool->lock, flags);
+    list_for_each_entry_safe(donor, tmp, &pool->donors, reclaim_node) {
+        if (donor->reclaim_expires_ns <= now) {
+            list_del_init(&donor->reclaim_node);
+            continue;
+        }
+        if (!reclaim_eligible(donor, res_data))
+            continue;
+
+        // The reclaimed budget is only valid until the earliest deadline it was taken from
+        if (!res_data->reclaimed_ns || donor->reclaim_expires_ns < res_data->reclaim_until_ns)
+            res_data->reclaim_until_ns = donor->reclaim_expires_ns;
+        res_data->reclaimed_ns += donor->reclaim_slack_ns;
+        res_data->reclaimed_total_ns += donor->reclaim_slack_ns;
+        list_del_init(&donor->reclaim_node);
+        taken = true;
+    }
+    spin_unlock_irqrestore(&pool->lock, flags);
+    return taken;
+}
+
+/**
+ * Called from context_switch when prev used up budget_ns, with the rq lock held
+ * Returns true if reclaimed slack covers the overrun and the thread keeps running, false if it is throttled.
+ */
+bool reclaim_extend(struct reservation_data *res_data, u64 budget_ns)
+{
+    u64 now;
+
+    if (!reclaiming || !reclaim_capable(res_data))
+        return false;
+
+    now = ktime_to_ns(ktime_get());
+    if (res_data->reclaimed_ns && res_data->reclaim_until_ns <= now)
+        res_data->reclaimed_ns = 0;   // Past the donor's deadline, what is left of it is gone
+
+    if (res_data->exec_accumulated_time < budget_ns + res_data->reclaimed_ns)
+        return true;
+
+    if (reclaim_take(res_data, now) && res_data->exec_accumulated_time < budget_ns + res_data->reclaimed_ns)
+        return true;
+    return false;
+}
+
+// Called from context_switch when prev is throttled for its budget, with the rq lock held
+void reclaim_throttle(struct reservation_data *res_data)
+{
+    if (reclaiming && reclaim_capable(res_data))
+        res_data->reclaim_throttled = true;
+}
+
+/**
+ * Donate the budget left in the current job, called from end_job by the thread itself
+ * The slack goes to the throttled reservation of the cpu that may use it with the highest priority
+ * (earliest deadline in EDF mode), or stays in the pool for the next one to run out of budget.
+ */
+void reclaim_donate(struct reservation_data *res_data)
+{
+    struct reclaim_pool *pool;
+    struct reservation_data *other, *best = NULL;
+    struct bucket_task_ll *curr;
+    struct timespec now_raw;
+    unsigned long flags;
+    u64 exec_ns, budget_ns, now;
+    int cpu = res_data->reserve_cpu;
+
+    if (!reclaiming || !reclaim_capable(res_data) || !res_data->jobs.job_active)
+        return;
+
+    // Include the time since the thread was last switched in
+    preempt_disable();
+    getrawmonotonic(&now_raw);
+    exec_ns = res_data->exec_accumulated_time + timespec_to_ns(&now_raw) -
+              timespec_to_ns(&res_data->exec_start_time);
+    preempt_enable();
+
+    budget_ns = timespec_to_ns(&res_data->reserve_C);
+    now = ktime_to_ns(ktime_get());
+    if (exec_ns >= budget_ns)
+        return;
+
+    pool = &per_cpu(reclaim_pools, cpu);
+    spin_lock_irqsave(&pool->lock, flags);
+    res_data->reclaim_slack_ns = budget_ns - exec_ns;
+    res_data->reclaim_expires_ns = res_data->jobs.release_ns + timespec_to_ns(&res_data->reserve_D);
+    res_data->reclaim_prio = res_data->task->rt_priority;
+    if (res_data->reclaim_expires_ns > now && list_empty(&res_data->reclaim_node))
+        list_add_tail(&res_data->reclaim_node, &pool->donors);
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    // Hand it to a throttled reservation right away, the processor bucket keeps it from exiting meanwhile
+    spin_lock(&processors_lock);
+    for (curr = rtes_bucket(cpu)->first_task; curr; curr = curr->next) {
+        if (!curr->task)
+            continue;   // Group reservation
+        other = curr->task->reservation_data;
+        if (!other || !other->reclaim_throttled || !reclaim_eligible(res_data, other))
+            continue;
+        if (!best || other->task->rt_priority > best->task->rt_priority ||
+            (other->task->rt_priority == best->task->rt_priority && other->edf &&
+             other->edf_deadline_ns < best->edf_deadline_ns))
+            best = other;
+    }
+    // Only reclaim_throttled threads are picked, no other sleep of the thread is cut short
+    if (best && reclaim_take(best, now)) {
+        best->reclaim_throttled = false;
+        wake_up_process(best->task);
+    }
+    spin_unlock(&processors_lock);
+}
+
+// Take the donated slack of res_data out of the pool of its cpu
+static void reclaim_withdraw(struct reservation_data *res_data)
+{
+    struct reclaim_pool *pool;
+    unsigned long flags;
+
+    res_data->reclaimed_ns = 0;
+    res_data->reclaim_throttled = false;
+    if (!rtes_cpu_valid(res_data->reserve_cpu))
+        return; // Never donated
+
+    pool = &per_cpu(reclaim_pools, res_data->reserve_cpu);
+    spin_lock_irqsave(&pool->lock, flags);
+    list_del_init(&res_data->reclaim_node);
+    spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+// New period, called by the replenishment timer: the reclaimed budget and donated slack of the last job end
+void reclaim_release(struct reservation_data *res_data)
+{
+    reclaim_withdraw(res_data);
+}
+
+// Called once when the reservation data is created
+void reclaim_init(struct reservation_data *res_data)
+{
+    INIT_LIST_HEAD(&res_data->reclaim_node);
+}
+
+// Withdraw the slack when the reservation is reset, cancelled or the thread exits
+void reclaim_stop(struct reservation_data *res_data)
+{
+    reclaim_withdraw(res_data);
+}
+
+static int __init reclaim_pools_init(void)
+{
+    struct reclaim_pool *pool;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        pool = &per_cpu(reclaim_pools, cpu);
+        spin_lock_init(&pool->lock);
+        INIT_LIST_HEAD(&pool->donors);
+    }
+    return 0;
+}
+
+core_initcall(reclaim_pools_init);
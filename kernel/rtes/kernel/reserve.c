@@ -22,27 +22,39 @@
 #include <linux/slab.h> 
 #include <linux/signal.h>
 #include <linux/list.h>
+#include <linux/rculist.h>
 #include <linux/math64.h>
 #include <linux/ktime.h>
 #include <linux/reservation.h>
 #include <linux/sysfs.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/percpu.h>
+#include <linux/topology.h>
+#include <linux/jiffies.h>
 #include "taskmon.h"
 
 enum partition_policy current_policy = FF; // Default policy is First Fit
-struct bucket_info processors[MAX_PROCESSORS];
+enum reserve_sched_policy current_sched_policy = RTES_RM; // Default is fixed priorities
+DEFINE_PER_CPU(struct bucket_info, rtes_buckets);
 
 static const char *policy_names[] = {
     [FF] = "FF",
     [NF] = "NF",
     [BF] = "BF",
     [WF] = "WF",
-    [LST] = "LST"
+    [LST] = "LST",
+    [CF] = "CF"
+};
+
+static const char *sched_policy_names[] = {
+    [RTES_RM] = "RM",
+    [RTES_EDF] = "EDF"
 };
 
 
 static spinlock_t policy_lock;
-static spinlock_t processors_lock;
+spinlock_t processors_lock;
 static spinlock_t reserved_tasks_list_lock;
 static DEFINE_MUTEX(bin_packing_mutex);
 
@@ -60,24 +72,18 @@ uint32_t div_C_T(uint32_t C, uint32_t T)
 
 void initialize_processors(void) {
     int i;
-    for (i = 0; i < MAX_PROCESSORS; i++) {
-        processors[i].running_util = 0;
-        processors[i].num_tasks = 0;
-        processors[i].first_task = NULL;
+    for_each_possible_cpu(i) {
+        rtes_bucket(i)->running_util = 0;
+        rtes_bucket(i)->num_tasks = 0;
+        rtes_bucket(i)->first_task = NULL;
     }
 }
 
-// List to store reserved tasks
-static LIST_HEAD(reserved_tasks_list);
-
-// Node in the list
-struct task_node {
-    struct task_struct *task; // Pointer to task_struct
-    struct list_head list;    // List head for linking
-};
+// List to store reserved tasks, changed under reserved_tasks_list_lock and read under RCU by /proc/rtes
+LIST_HEAD(reserved_tasks_list);
 
 void add_task_to_list(struct task_struct *task) {
-    struct task_node *new_node;
+    struct reserved_task *new_node;
 
     new_node = kmalloc(sizeof(*new_node), GFP_KERNEL);
     if (!new_node) {
@@ -89,19 +95,19 @@ void add_task_to_list(struct task_struct *task) {
     INIT_LIST_HEAD(&new_node->list);
 
     spin_lock(&reserved_tasks_list_lock); // Acquire the lock
-    list_add_tail(&new_node->list, &reserved_tasks_list);
+    list_add_tail_rcu(&new_node->list, &reserved_tasks_list);
     spin_unlock(&reserved_tasks_list_lock); // Release the lock
 }
 
 void remove_task_from_list(struct task_struct *task) {
-    struct task_node *node, *tmp;
+    struct reserved_task *node, *tmp;
 
     spin_lock(&reserved_tasks_list_lock); // Acquire the lock
     list_for_each_entry_safe(node, tmp, &reserved_tasks_list, list) {
         if (node->task == task) {
-            list_del(&node->list);
+            list_del_rcu(&node->list);
             spin_unlock(&reserved_tasks_list_lock); // Release before freeing
-            kfree(node);
+            kfree_rcu(node, rcu);
             return;
         }
     }
@@ -132,15 +138,15 @@ void turn_off_unused_processors(void) {
     int online_cpus = 0;
 
     // Count the number of currently online CPUs
-    for (i = 0; i < MAX_PROCESSORS; i++) {
+    for_each_possible_cpu(i) {
         if (cpu_online(i)) {
             online_cpus++;
         }
     }
 
     // Turn off unused processors while keeping at least one online
-    for (i = 0; i < MAX_PROCESSORS; i++) {
-        if (processors[i].num_tasks == 0 && cpu_online(i)) {
+    for_each_possible_cpu(i) {
+        if (rtes_bucket(i)->num_tasks == 0 && cpu_online(i)) {
             if (online_cpus > 1) { // Ensure at least one CPU remains online
                 if (cpu_down(i) == 0) {
                     printk(KERN_INFO "Processor %d successfully turned off\n", i);
@@ -167,6 +173,13 @@ struct reservation_data *create_reservation_data(struct task_struct *task) {
     memset(res_data, 0, sizeof(struct reservation_data));
     INIT_LIST_HEAD(&res_data->data_points);
     spin_lock_init(&res_data->data_lock);
+    spin_lock_init(&res_data->jobs.lock);
+    spin_lock_init(&res_data->exec.lock);
+    INIT_WORK(&res_data->profile_work, profile_work_fn);
+    cbs_init(res_data);
+    split_init(res_data);
+    reclaim_init(res_data);
+    overrun_init(res_data);
     res_data->taskmon_kobj = NULL;
     res_data->has_reservation = false;
     res_data->monitoring_enabled = false;
@@ -189,24 +202,41 @@ enum hrtimer_restart reservation_timer_callback(struct hrtimer *timer) {
     struct data_point *point;
     unsigned long flags;
     u64 exec_ns, period_ns, utilization_integer;
-    u32 utilization_fraction, remainder;
+    u32 utilization_fraction;
     char utilization_str[32];
+    u64 start_ns = local_clock();
+    bool first = res_data->offset_pending;
 
-    exec_ns = res_data->exec_accumulated_time;
+    // Time run before a release offset is not part of a job
+    res_data->offset_pending = false;
+    exec_ns = first ? 0 : res_data->exec_accumulated_time;
     period_ns = timespec_to_ns(&res_data->reserve_T);
 
-    res_data->period_count++;  // Increment the period count
-    utilization_integer = div_u64_rem(exec_ns * 100, (u32)period_ns, &remainder);
-    utilization_fraction = div_u64_rem((u64)remainder * 100, (u32)period_ns, &remainder);
+    // Release the next job at the nominal timer expiry
+    job_release(res_data, ktime_to_ns(hrtimer_get_expires(timer)), task_curr(task));
+
+    if (!first) {
+        res_data->period_count++;  // Increment the period count
+        exec_stats_add(res_data, exec_ns);
+    }
+
+    // Profile mode: propose a budget once enough periods have been recorded
+    if (!first && res_data->profiling && res_data->profile_periods_left > 0) {
+        if (--res_data->profile_periods_left == 0)
+            schedule_work(&res_data->profile_work);
+    }
+    // Utilization as a fraction of the period, integer part and hundredths
+    utilization_integer = div_u64_rem(div64_u64(exec_ns * 100, period_ns), 100, &utilization_fraction);
 
-    // Format the result as a floating-point style string "0.xx"
-    snprintf(utilization_str, sizeof(utilization_str), "0.%02llu", utilization_integer);
+    // Format the result as a floating-point style string "x.xx", 1.00 for a full period
+    snprintf(utilization_str, sizeof(utilization_str), "%llu.%02u",
+             utilization_integer, utilization_fraction);
 
     // Print the utilization for debugging purposes
     // printk(KERN_INFO "Utilization: %s\n", utilization_str);
     
     // Collect utilization data if monitoring is enabled
-    if (taskmon_enabled && res_data->monitoring_enabled) {
+    if (!first && taskmon_enabled && res_data->monitoring_enabled) {
         point = kmalloc(sizeof(*point), GFP_ATOMIC);
         if (point) {
             point->timestamp = div64_u64((u64)res_data->period_count * period_ns, 1000000); // Convert to ms
@@ -225,14 +255,30 @@ enum hrtimer_restart reservation_timer_callback(struct hrtimer *timer) {
 
     // New period so reset states:
     res_data->exec_accumulated_time = 0;  // Reset accumulated time
-    // Wake up task at new period if it has been suspended
-    if (task->state == TASK_UNINTERRUPTIBLE) {
+
+    // Reclaimed budget and donated slack do not outlive the job, nor does a demotion
+    reclaim_release(res_data);
+    overrun_release(res_data, exec_ns);
+
+    // A split task starts every job with its first portion
+    if (res_data->split.parts) {
+        split_release(res_data, ktime_to_ns(hrtimer_get_expires(timer)));
+    }
+    // In EDF mode the job released now is due D after its release
+    if (res_data->edf) {
+        rtes_edf_set_deadline(task, ktime_to_ns(hrtimer_get_expires(timer)) + timespec_to_ns(&res_data->reserve_D));
+    }
+
+    // Wake up task at new period if it has been suspended, a CBS gets its budget back from cbs_timer
+    if (res_data->reserve_type == RESERVE_PERIODIC && task->state == TASK_UNINTERRUPTIBLE) {
         wake_up_process(task);
+        rtes_event(RTES_EVENT_REPLENISH, task, res_data->reserve_cpu, exec_ns);
     }
 
 
     // Hrtimer will end until you restart it again!
     hrtimer_forward_now(timer, ktime_set(0, period_ns)); // Forward timer to next period
+    overhead_timer(start_ns);
     return HRTIMER_RESTART;
 }
 
@@ -250,17 +296,18 @@ uint32_t utilization_bound(uint32_t n) {
 }
 
 
-static int response_time_test(struct timespec *c, struct timespec *t, int task_idx, int total_tasks, struct timespec *c_list, struct timespec *t_list) {
-    uint64_t R_prev, R_curr, T_i, C_i, C_j, T_j, interference;
+static int response_time_test(struct timespec *c, struct timespec *t, int task_idx, int total_tasks, struct timespec *c_list, struct timespec *t_list, struct timespec *d_list, u64 *b_list) {
+    uint64_t R_prev, R_curr, D_i, C_i, B_i, C_j, T_j, interference;
     int iteration, j;
 
     // task under test, start rt test when that task begins to need more than UB
     C_i = timespec_to_ns(&c_list[task_idx]);
-    T_i = timespec_to_ns(&t_list[task_idx]);
+    D_i = timespec_to_ns(&d_list[task_idx]);
+    B_i = b_list[task_idx];     // blocking by lower priority tasks, see blocking.c
 
     printk(KERN_INFO "Starting RT Test for Task.\n");
-    // response time R_0 = C_1 + C_2 + ... + C_i
-    R_prev = 0;
+    // response time R_0 = B_i + C_1 + C_2 + ... + C_i
+    R_prev = B_i;
     for (j = 0; j <= task_idx; j++) {
         R_prev += timespec_to_ns(&c_list[j]);
     }
@@ -276,11 +323,16 @@ static int response_time_test(struct timespec *c, struct timespec *t, int task_i
         }
 
         // Calculate new response time
-        R_curr = C_i + interference;
+        R_curr = C_i + B_i + interference;
+
+        // Past the deadline the response time can only grow
+        if (R_curr > D_i) {
+            break;
+        }
 
         // Check if response time converges
         if (R_curr == R_prev) {
-            if (R_curr <= T_i) {
+            if (R_curr <= D_i) {
                 return 0; // schedulable
             } else {
                 
@@ -295,56 +347,180 @@ static int response_time_test(struct timespec *c, struct timespec *t, int task_i
         }
     }
 
-    printk(KERN_ERR "Task %d failed RT test with response time R_curr=%llu and T_i=%llu.\n", task_idx, R_curr, T_i);
+    printk(KERN_ERR "Task %d failed RT test with response time R_curr=%llu and D_i=%llu.\n", task_idx, R_curr, D_i);
     return -EBUSY; 
 }
 
 /**
- * Check if new task can be schedulable based on UB and then RT tests
+ * EDF admission for one cpu: the task set is schedulable iff sum(C/T) <= 1 when D = T, and if the
+ * density sum(C/D) <= 1 when deadlines are constrained (sufficient only).
+ * With blocking terms each task k, in deadline order, also needs sum_{j<=k} C_j/D_j + B_k/D_k <= 1.
+ * Each term is rounded up in ppm so the truncation can never admit an overloaded cpu.
+ */
+static int edf_schedulability_test(int cpuid, struct timespec *c_list, struct timespec *d_list, u64 *b_list,
+                                   int num_task) {
+    u64 U = 0, D_k;
+    int i;
+
+    for (i = 0; i < num_task; i++) {
+        D_k = timespec_to_ns(&d_list[i]);
+        U += div64_u64(timespec_to_ns(&c_list[i]) * 1000000 + D_k - 1, D_k);
+        if (b_list[i] && U + div64_u64(b_list[i] * 1000000 + D_k - 1, D_k) > 1000000) {
+            printk(KERN_ERR "EDF test failed on cpu%d: task %d blocked too long. Not schedulable.\n", cpuid, i);
+            return -EBUSY;
+        }
+    }
+
+    printk(KERN_INFO "EDF Test for cpu%d: %d tasks, U=%llu ppm.\n", cpuid, num_task, U);
+    if (U > 1000000) {
+        printk(KERN_ERR "EDF test failed on cpu%d. Not schedulable.\n", cpuid);
+        return -EBUSY;
+    }
+    return 0;
+}
+
+// Trace of the admission test, only with pr_debug for the portion search of split.c that runs it per candidate
+#define admission_printk(portion, level, fmt, ...)                    \
+    do {                                                              \
+        if (portion)                                                  \
+            pr_debug(fmt, ##__VA_ARGS__);                             \
+        else                                                          \
+            printk(level fmt, ##__VA_ARGS__);                         \
+    } while (0)
+
+/**
+ * Check if new task can be schedulable based on UB and then RT tests, or on the EDF test in EDF mode
+ * Tasks are analysed in deadline-monotonic order, which is rate-monotonic when D = T. The UB test
+ * only holds for implicit deadlines, so any D < T on the cpu sends every task to the RT test, and so
+ * does any critical section that adds blocking terms (see blocking.c).
+ * A portion of a split task (see split.c) runs above the partitioned tasks of its cpu and is analysed
+ * first, with its window as deadline. A cpu takes at most one portion.
+ * With overhead_aware every C includes the measured kernel time of a job on the cpu (see overhead.c).
  * @param cpuid cpu id to check schedulability
  * @param c computation time of new task to be added
  * @param t period of new task to be added
+ * @param d relative deadline of new task to be added, D <= T
+ * @param cs_ns longest critical section of the new task
+ * @param skip reserved task left out of the set, used when changing the budget of an admitted task
+ * @param portion the new task is a portion of a split task
  */
-int check_schedulability(int cpuid, struct timespec c, struct timespec t) {
+static int __check_schedulability(int cpuid, struct timespec c, struct timespec t, struct timespec d,
+                                  u64 cs_ns, struct task_struct *skip, bool portion) {
     // Utilization Bound (UB) Test
     uint32_t UB, C_i, T_i, U = 0;
-    struct task_node *node;
+    struct reserved_task *node;
     struct reservation_data *res_data;
-    struct timespec c_list[MAX_TASKS], t_list[MAX_TASKS];
+    struct timespec c_list[MAX_TASKS], t_list[MAX_TASKS], d_list[MAX_TASKS];
+    u64 cs_list[MAX_TASKS], b_list[MAX_TASKS], overhead_ns;
+    bool top_list[MAX_TASKS];
+    bool constrained = false, blocking = false;
     // Init variables with the newly added task
     int num_task = 0;
     int i, j, k;
 
     c_list[num_task] = c;
     t_list[num_task] = t;
+    d_list[num_task] = d;
+    cs_list[num_task] = cs_ns;
+    top_list[num_task] = portion;
     num_task++;
 
     // get the a list for each task on the same cpu
     spin_lock(&reserved_tasks_list_lock);
     list_for_each_entry(node, &reserved_tasks_list, list) {
+        res_data = node->task->reservation_data;
+        if (node->task == skip || res_data->group)
+            continue;   // Members of a group are accounted once for the whole group below
+
+        // Portions of split tasks on this cpu
+        for (k = 0; k < res_data->split.parts; k++) {
+            if (res_data->split.cpu[k] != cpuid)
+                continue;
+            if (portion || num_task >= MAX_TASKS) {
+                spin_unlock(&reserved_tasks_list_lock);
+                return portion ? -EBUSY : -ENOMEM;
+            }
+            c_list[num_task] = res_data->split.C[k];
+            t_list[num_task] = res_data->reserve_T;
+            d_list[num_task] = ns_to_timespec(res_data->split.window_ns);
+            cs_list[num_task] = 0;
+            top_list[num_task] = true;
+            num_task++;
+        }
+
         // Only if on the same cpu, take into account
-        if (task_cpu(node->task) == cpuid) {
-            res_data = node->task->reservation_data;
-            c_list[num_task] = res_data->reserve_C;
+        if (!res_data->split.parts && res_data->reserve_cpu == cpuid) {
+            if (num_task >= MAX_TASKS) {
+                spin_unlock(&reserved_tasks_list_lock);
+                printk(KERN_ERR "Exceeded MAX_TASKS for schedulability check.\n");
+                return -ENOMEM;
+            }
+            c_list[num_task] = ns_to_timespec(overrun_admitted_ns(res_data));
             t_list[num_task] = res_data->reserve_T;
+            d_list[num_task] = res_data->reserve_D;
+            cs_list[num_task] = blocking_cs_ns(res_data);
+            top_list[num_task] = false;
             num_task++;
         }
     }
     spin_unlock(&reserved_tasks_list_lock);
 
-    // bubble sort the tasks based on period in ascending order
+    // Group reservations of this cpu, each a single task
+    k = reserve_group_params(cpuid, c_list + num_task, t_list + num_task, d_list + num_task,
+                             MAX_TASKS - num_task);
+    if (k < 0) {
+        printk(KERN_ERR "Exceeded MAX_TASKS for schedulability check.\n");
+        return -ENOMEM;
+    }
+    for (i = num_task; i < num_task + k; i++) {
+        cs_list[i] = 0;
+        top_list[i] = false;
+    }
+    num_task += k;
+
+    // Timer and context switches of every job, see overhead.c
+    overhead_ns = overhead_job_ns(cpuid);
+    for (i = 0; overhead_ns && i < num_task; i++)
+        timespec_add_ns(&c_list[i], overhead_ns);
+
+    // bubble sort the tasks based on deadline in ascending order, split portions first
     for (i = 0; i < num_task - 1; i++) {
         for (j = i + 1; j < num_task; j++) {
-            if (timespec_to_ns(&t_list[i]) > timespec_to_ns(&t_list[j])) {
-                struct timespec tmp_c = c_list[i], tmp_t = t_list[i];
+            if ((top_list[j] && !top_list[i]) ||
+                (top_list[i] == top_list[j] && timespec_to_ns(&d_list[i]) > timespec_to_ns(&d_list[j]))) {
+                struct timespec tmp_c = c_list[i], tmp_t = t_list[i], tmp_d = d_list[i];
+                u64 tmp_cs = cs_list[i];
+                bool tmp_top = top_list[i];
                 c_list[i] = c_list[j];
                 t_list[i] = t_list[j];
+                d_list[i] = d_list[j];
+                cs_list[i] = cs_list[j];
+                top_list[i] = top_list[j];
                 c_list[j] = tmp_c;
                 t_list[j] = tmp_t;
+                d_list[j] = tmp_d;
+                cs_list[j] = tmp_cs;
+                top_list[j] = tmp_top;
             }
         }
     }
 
+    // B_i: each task below i may block it once, for its longest critical section
+    b_list[num_task - 1] = 0;
+    for (i = num_task - 2; i >= 0; i--)
+        b_list[i] = b_list[i + 1] + cs_list[i + 1];
+
+    for (i = 0; i < num_task; i++) {
+        if (timespec_compare(&d_list[i], &t_list[i]) < 0)
+            constrained = true;
+        if (b_list[i])
+            blocking = true;
+    }
+
+    if (current_sched_policy == RTES_EDF) {
+        return edf_schedulability_test(cpuid, c_list, d_list, b_list, num_task);
+    }
+
      // Perform UB Test and RT Test if necessary
     for (i = 0; i < num_task; i++) {
         C_i = timespec_to_ns(&c_list[i]);
@@ -352,26 +528,26 @@ int check_schedulability(int cpuid, struct timespec c, struct timespec t) {
         U += div_C_T(C_i, T_i);
 
         UB = utilization_bound(i + 1);
-        printk(KERN_INFO "UB Test for cpu%d: Task %d, U=%u, UB=%u.\n", cpuid, i + 1, U, UB);
+        admission_printk(portion, KERN_INFO, "UB Test for cpu%d: Task %d, U=%u, UB=%u.\n", cpuid, i + 1, U, UB);
 
-        if (U > UB) {
-            // UB test fails; perform RT test
-            printk(KERN_INFO "UB test failed at task %d. Running RT test.\n", i+1);
+        if (U > UB || constrained || blocking) {
+            // UB test fails or does not apply; perform RT test
+            admission_printk(portion, KERN_INFO, "UB test failed at task %d. Running RT test.\n", i+1);
 
             if (num_task >= MAX_TASKS) {
                 printk(KERN_ERR "Exceeded MAX_TASKS for schedulability check.\n");
                 return -ENOMEM;
             }
 
-            if (response_time_test(c_list, t_list, i, num_task, c_list, t_list) != 0) {
-                printk(KERN_ERR "Task %d failed RT test. Not schedulable.\n", i);
+            if (response_time_test(c_list, t_list, i, num_task, c_list, t_list, d_list, b_list) != 0) {
+                admission_printk(portion, KERN_ERR, "Task %d failed RT test. Not schedulable.\n", i);
                 return -EBUSY;
             }
 
             // continue testing subsequent tasks
             for (k = i + 1; k < num_task; k++) {
-                if (response_time_test(c_list, t_list, k, num_task, c_list, t_list) != 0) {
-                    printk(KERN_ERR "Task %d failed RT test. Not schedulable.\n", k);
+                if (response_time_test(c_list, t_list, k, num_task, c_list, t_list, d_list, b_list) != 0) {
+                    admission_printk(portion, KERN_ERR, "Task %d failed RT test. Not schedulable.\n", k);
                     return -EBUSY; 
                 }
             }
@@ -379,29 +555,150 @@ int check_schedulability(int cpuid, struct timespec c, struct timespec t) {
             break; 
         }
     }
-    printk(KERN_INFO "Task schedulable on CPU %d\n", cpuid);
+    admission_printk(portion, KERN_INFO, "Task schedulable on CPU %d\n", cpuid);
     return 0; // Success
 }
 
+int check_schedulability(int cpuid, struct timespec c, struct timespec t, struct timespec d, struct task_struct *skip) {
+    struct reservation_data *res_data = skip ? skip->reservation_data : NULL;
+    u64 cs_ns = 0;
+
+    // skip is admitted again with new parameters and keeps its critical section
+    if (res_data)
+        cs_ns = min(max(res_data->block_declared_ns, res_data->block_measured_ns), (u64)timespec_to_ns(&c));
+    return __check_schedulability(cpuid, c, t, d, cs_ns, skip, false);
+}
+
+/**
+ * Global mode (cpuid = -2)
+ *  The thread keeps a full affinity mask and the rt class places it with its cpupri based push/pull
+ *  (sched_cpupri.c, sched_rt.c), so the global reservations form one fixed-priority system on all cpus.
+ *  Budgets are enforced per thread as in the partitioned modes. Admission is the response time analysis
+ *  for global FP of Bertogna and Cirinei, in deadline-monotonic order on the m cpus of the affinity mask:
+ *    R_k = C_k + floor(1/m * sum_{i<k} min(W_i(R_k), R_k - C_k + 1))
+ *    W_i(L) = N_i(L) * C_i + min(C_i, L + R_i - C_i - N_i(L) * T_i),  N_i(L) = floor((L + R_i - C_i) / T_i)
+ *  Global and partitioned reservations are never mixed, and global mode needs the RM scheduling policy
+ *  since the push/pull logic places tasks by priority, not by deadline.
+ */
+static int global_schedulability_test(struct timespec c, struct timespec t, struct timespec d,
+                                      struct task_struct *skip, int m) {
+    u64 C[MAX_TASKS], T[MAX_TASKS], D[MAX_TASKS], R[MAX_TASKS];
+    u64 interference, R_next, L, N, W, tmp;
+    struct reservation_data *res_data;
+    struct reserved_task *node;
+    int i, j, k, iteration, num_task = 0;
+
+    C[num_task] = timespec_to_ns(&c);
+    T[num_task] = timespec_to_ns(&t);
+    D[num_task] = timespec_to_ns(&d);
+    num_task++;
+
+    spin_lock(&reserved_tasks_list_lock);
+    list_for_each_entry(node, &reserved_tasks_list, list) {
+        res_data = node->task->reservation_data;
+        if (res_data->reserve_cpu != RTES_GLOBAL_CPU || node->task == skip)
+            continue;
+        if (num_task >= MAX_TASKS) {
+            spin_unlock(&reserved_tasks_list_lock);
+            printk(KERN_ERR "Exceeded MAX_TASKS for schedulability check.\n");
+            return -ENOMEM;
+        }
+        C[num_task] = overrun_admitted_ns(res_data);
+        T[num_task] = timespec_to_ns(&res_data->reserve_T);
+        D[num_task] = timespec_to_ns(&res_data->reserve_D);
+        num_task++;
+    }
+    spin_unlock(&reserved_tasks_list_lock);
+
+    // Timer and context switches of every job, see overhead.c
+    tmp = overhead_job_ns(RTES_GLOBAL_CPU);
+    for (i = 0; i < num_task; i++)
+        C[i] += tmp;
+
+    // bubble sort the tasks based on deadline in ascending order
+    for (i = 0; i < num_task - 1; i++) {
+        for (j = i + 1; j < num_task; j++) {
+            if (D[i] > D[j]) {
+                tmp = C[i]; C[i] = C[j]; C[j] = tmp;
+                tmp = T[i]; T[i] = T[j]; T[j] = tmp;
+                tmp = D[i]; D[i] = D[j]; D[j] = tmp;
+            }
+        }
+    }
+
+    for (k = 0; k < num_task; k++) {
+        R[k] = C[k];
+
+        // With fewer higher priority tasks than cpus, a cpu is always free
+        for (iteration = 0; k >= m && iteration < 50; iteration++) {
+            L = R[k];
+            interference = 0;
+            for (i = 0; i < k; i++) {
+                N = div64_u64(L + R[i] - C[i], T[i]);
+                W = N * C[i] + min(C[i], L + R[i] - C[i] - N * T[i]);
+                interference += min(W, L - C[k] + 1);
+            }
+            R_next = C[k] + div_u64(interference, m);
+            if (R_next == R[k] || R_next > D[k]) {
+                R[k] = R_next;
+                break;
+            }
+            R[k] = R_next;
+        }
+
+        if (R[k] > D[k] || iteration == 50) {
+            printk(KERN_ERR "Task %d failed global RT test. Not schedulable.\n", k);
+            return -EBUSY;
+        }
+    }
+    return 0;
+}
+
+// Whether a reservation other than skip exists in global mode (global) or in a partitioned mode (!global)
+static bool has_reservations(bool global, struct task_struct *skip) {
+    struct reserved_task *node;
+    bool found = false;
+
+    spin_lock(&reserved_tasks_list_lock);
+    list_for_each_entry(node, &reserved_tasks_list, list) {
+        if (node->task != skip &&
+            (node->task->reservation_data->reserve_cpu == RTES_GLOBAL_CPU) == global) {
+            found = true;
+            break;
+        }
+    }
+    spin_unlock(&reserved_tasks_list_lock);
+
+    // A group is a partitioned reservation even before it has members
+    if (!found && !global)
+        found = reserve_groups_exist();
+    return found;
+}
+
+// Admission of a portion (c, t) of a split task with window w on cpuid, see split.c
+int check_portion_schedulability(int cpuid, struct timespec c, struct timespec t, struct timespec w) {
+    return __check_schedulability(cpuid, c, t, w, 0, NULL, true);
+}
+
 
-int find_best_processor(uint32_t util, enum partition_policy policy, struct timespec C, struct timespec T) {
+int find_best_processor(uint32_t util, enum partition_policy policy, struct timespec C, struct timespec T, struct timespec D) {
     int best_processor = -1;
-    int i;
+    int i, j;
     static int last_processor = 0;
     uint32_t remaining_space, min_space_left = 1001, max_space_left = 0; // ala  min space over 100% utilization
-    uint32_t min_util = 1001;
+    uint32_t min_util = 1001, cluster_util, max_cluster_util = 0;
 
     printk(KERN_INFO "Finding best processor for task with util=%u, policy=%s\n", util, policy_names[policy]);
     switch (policy) {
         case FF: // First-Fit
-            for (i = 0; i < MAX_PROCESSORS; i++) {
-                if (processors[i].running_util + util <= 1000) {
+            for_each_possible_cpu(i) {
+                if (rtes_bucket(i)->running_util + util <= 1000) {
                     // printk(KERN_INFO "First-Fit: Processor %d selected, running_util=%u, util=%u\n",
-                    //        i, processors[i].running_util, util);
+                    //        i, rtes_bucket(i)->running_util, util);
                     // return i;
-                    if (check_schedulability(i, C, T) == 0) {
+                    if (check_schedulability(i, C, T, D, NULL) == 0) {
                         printk(KERN_INFO "First-Fit: Processor %d selected, running_util=%u, util=%u\n",
-                           i, processors[i].running_util, util);
+                           i, rtes_bucket(i)->running_util, util);
                         return i;
                     }
                 }
@@ -409,18 +706,18 @@ int find_best_processor(uint32_t util, enum partition_policy policy, struct time
             break;
 
         case NF: // Next-Fit
-            for (i = 0; i < MAX_PROCESSORS; i++) {
-                int idx = (last_processor + i) % MAX_PROCESSORS;    // Start from the last processor
-                if (processors[idx].running_util + util <= 1000) {
+            for (i = 0; i < nr_cpu_ids; i++) {
+                int idx = (last_processor + i) % nr_cpu_ids;    // Start from the last processor
+                if (cpu_possible(idx) && rtes_bucket(idx)->running_util + util <= 1000) {
 
                     // last_processor = idx;
                     // printk(KERN_INFO "Next-Fit: Processor %d selected, running_util=%u, util=%u\n",
-                    //        idx, processors[idx].running_util, util);
+                    //        idx, rtes_bucket(idx)->running_util, util);
                     // return idx;
-                    if (check_schedulability(idx, C, T) == 0) {
+                    if (check_schedulability(idx, C, T, D, NULL) == 0) {
                         last_processor = idx;
                         printk(KERN_INFO "Next-Fit: Processor %d selected, running_util=%u, util=%u\n",
-                           idx, processors[idx].running_util, util);
+                           idx, rtes_bucket(idx)->running_util, util);
                         return idx;
                     }
                 }
@@ -428,14 +725,14 @@ int find_best_processor(uint32_t util, enum partition_policy policy, struct time
             break;
 
         case BF: // Best-Fit
-            for (i = 0; i < MAX_PROCESSORS; i++) {
-                remaining_space = 1000 - processors[i].running_util;
+            for_each_possible_cpu(i) {
+                remaining_space = 1000 - rtes_bucket(i)->running_util;
                 if (remaining_space >= util) {
                     if (remaining_space < min_space_left) {
                             min_space_left = remaining_space;
                             best_processor = i;
                     }
-                    // if (check_schedulability(i, C, T) == 0) {
+                    // if (check_schedulability(i, C, T, D, NULL) == 0) {
                     //     if (remaining_space < min_space_left) {
                     //         min_space_left = remaining_space;
                     //         best_processor = i;
@@ -446,7 +743,7 @@ int find_best_processor(uint32_t util, enum partition_policy policy, struct time
 
             if (best_processor != -1) {
                 printk(KERN_INFO "Best-Fit: Processor %d selected, running_util=%u, util=%u\n",
-                    best_processor, processors[best_processor].running_util, util);
+                    best_processor, rtes_bucket(best_processor)->running_util, util);
             } else {
                 printk(KERN_ERR "Best-Fit: No suitable processor found for util=%u\n", util);
             }
@@ -454,14 +751,14 @@ int find_best_processor(uint32_t util, enum partition_policy policy, struct time
             return best_processor;
 
         case WF: // Worst-Fit
-            for (i = 0; i < MAX_PROCESSORS; i++) {
-                remaining_space = 1000 - processors[i].running_util;
+            for_each_possible_cpu(i) {
+                remaining_space = 1000 - rtes_bucket(i)->running_util;
                 if (remaining_space >= util) {
                     if (remaining_space > max_space_left) {
                             max_space_left = remaining_space;
                             best_processor = i;
                     }
-                    // if (check_schedulability(i, C, T) == 0) {
+                    // if (check_schedulability(i, C, T, D, NULL) == 0) {
                     //     if (remaining_space > max_space_left) {
                     //         max_space_left = remaining_space;
                     //         best_processor = i;
@@ -472,18 +769,18 @@ int find_best_processor(uint32_t util, enum partition_policy policy, struct time
 
             if (best_processor != -1) {
                 printk(KERN_INFO "Worst-Fit: Processor %d selected, running_util=%u, util=%u\n",
-                       best_processor, processors[best_processor].running_util, util);
+                       best_processor, rtes_bucket(best_processor)->running_util, util);
             } else {
                 printk(KERN_ERR "Worst-Fit: No suitable processor found for util=%u\n", util);
             }
 
             return best_processor;
         case LST:
-            for (i = 0; i < MAX_PROCESSORS; i++) {
-                if (processors[i].running_util + util < 1001) {
-                    if (check_schedulability(i, C, T) == 0) {
-                        if (processors[i].running_util < min_util) {
-                            min_util = processors[i].running_util;
+            for_each_possible_cpu(i) {
+                if (rtes_bucket(i)->running_util + util < 1001) {
+                    if (check_schedulability(i, C, T, D, NULL) == 0) {
+                        if (rtes_bucket(i)->running_util < min_util) {
+                            min_util = rtes_bucket(i)->running_util;
                             best_processor = i;
                         }
                     }
@@ -492,13 +789,42 @@ int find_best_processor(uint32_t util, enum partition_policy policy, struct time
 
             if (best_processor != -1) {
                 printk(KERN_INFO "List-Scheduling: Processor %d selected, running_util=%u, util=%u\n",
-                    best_processor, processors[best_processor].running_util, util);
+                    best_processor, rtes_bucket(best_processor)->running_util, util);
             } else {
                 printk(KERN_ERR "List-Scheduling: No suitable processor found for util=%u\n", util);
             }
 
             return best_processor;
 
+        case CF: // Cluster-Fit
+            /**
+             * First fit within the most loaded cluster the task fits in, so that reservations share the
+             * clusters already in use and the others can stay idle or offline. Without topology information
+             * every cpu is a cluster of its own and this is a best fit.
+             */
+            for_each_possible_cpu(i) {
+                if (rtes_bucket(i)->running_util + util > 1000)
+                    continue;
+                cluster_util = 0;
+                for_each_cpu_and(j, topology_core_cpumask(i), cpu_possible_mask)
+                    cluster_util += rtes_bucket(j)->running_util;
+                if (best_processor != -1 && cluster_util <= max_cluster_util)
+                    continue;
+                if (check_schedulability(i, C, T, D, NULL) == 0) {
+                    max_cluster_util = cluster_util;
+                    best_processor = i;
+                }
+            }
+
+            if (best_processor != -1) {
+                printk(KERN_INFO "Cluster-Fit: Processor %d selected, running_util=%u, util=%u\n",
+                    best_processor, rtes_bucket(best_processor)->running_util, util);
+            } else {
+                printk(KERN_ERR "Cluster-Fit: No suitable processor found for util=%u\n", util);
+            }
+
+            return best_processor;
+
         default:
             printk(KERN_ERR "Unknown partitioning policy.\n");
             return -1;
@@ -514,22 +840,32 @@ void print_processor_info(int cpuid) {
     int task_count = 0;
 
     printk(KERN_INFO "Processor %d Info:", cpuid);
-    printk(KERN_INFO "  Running Utilization: %u", processors[cpuid].running_util);
-    printk(KERN_INFO "  Number of Tasks: %d", processors[cpuid].num_tasks);
+    printk(KERN_INFO "  Running Utilization: %u", rtes_bucket(cpuid)->running_util);
+    printk(KERN_INFO "  Number of Tasks: %d", rtes_bucket(cpuid)->num_tasks);
 
-    curr = processors[cpuid].first_task;
+    curr = rtes_bucket(cpuid)->first_task;
     while (curr) {
-        printk(KERN_INFO "    Task %d: Util=%u, Cost=%lu.%09lu, Period=%lu.%09lu",
-               curr->task->pid, curr->util,
+        printk(KERN_INFO "    %s %d: Util=%u, Cost=%lu.%09lu, Period=%lu.%09lu",
+               curr->task ? "Task" : "Group", curr->task ? curr->task->pid : curr->group->id, curr->util,
                curr->cost.tv_sec, curr->cost.tv_nsec,
                curr->period.tv_sec, curr->period.tv_nsec);
         curr = curr->next;
         task_count++;
     }
 
-    if (task_count != processors[cpuid].num_tasks) {
+    if (task_count != rtes_bucket(cpuid)->num_tasks) {
         printk(KERN_ERR "Processor %d task count mismatch! Expected %d, Found %d",
-               cpuid, processors[cpuid].num_tasks, task_count);
+               cpuid, rtes_bucket(cpuid)->num_tasks, task_count);
+    }
+}
+
+// Print the buckets of the processors that have reservations
+static void print_processors_info(void) {
+    int i;
+
+    for_each_possible_cpu(i) {
+        if (rtes_bucket(i)->num_tasks)
+            print_processor_info(i);
     }
 }
 
@@ -538,35 +874,78 @@ void add_task_to_processor(struct task_struct *task, struct timespec C, struct t
     uint32_t util = div_C_T(timespec_to_ns(&C), timespec_to_ns(&T));
     // int i;
 
-    turn_on_processor(cpuid); // Ensure the processor is online
-
-    new_task = kmalloc(sizeof(*new_task), GFP_KERNEL);
+    // Called with processors_lock held, the caller has brought the processor online
+    new_task = kmalloc(sizeof(*new_task), GFP_ATOMIC);
+    if (!new_task) {
+        printk(KERN_ERR "Failed to account task %d on processor %d\n", task->pid, cpuid);
+        return;
+    }
 
     new_task->task = task;
+    new_task->group = NULL;
     new_task->util = util;
     new_task->cost = C;
     new_task->period = T;
-    new_task->next = processors[cpuid].first_task;
-    processors[cpuid].first_task = new_task;
+    new_task->next = rtes_bucket(cpuid)->first_task;
+    rtes_bucket(cpuid)->first_task = new_task;
 
-    processors[cpuid].running_util += util;
-    processors[cpuid].num_tasks++;
+    rtes_bucket(cpuid)->running_util += util;
+    rtes_bucket(cpuid)->num_tasks++;
 
     printk(KERN_INFO "Task %d added to processor %d. Utilization: %u\n", task->pid, cpuid, util);
-    print_processor_info(0);
-    print_processor_info(1);
-    print_processor_info(2);
-    print_processor_info(3);
+    print_processors_info();
+}
+
+// Account an admitted group in the bucket of its processor, as a single task, the processor is online
+static int add_group_to_processor(struct reserve_group *group) {
+    struct bucket_task_ll *new_task;
+
+    new_task = kmalloc(sizeof(*new_task), GFP_KERNEL);
+    if (!new_task)
+        return -ENOMEM;
+
+    new_task->task = NULL;
+    new_task->group = group;
+    new_task->util = div_C_T(timespec_to_ns(&group->C), timespec_to_ns(&group->T));
+    new_task->cost = group->C;
+    new_task->period = group->T;
+
+    spin_lock(&processors_lock);
+    new_task->next = rtes_bucket(group->cpu)->first_task;
+    rtes_bucket(group->cpu)->first_task = new_task;
+    rtes_bucket(group->cpu)->running_util += new_task->util;
+    rtes_bucket(group->cpu)->num_tasks++;
+    spin_unlock(&processors_lock);
+
+    printk(KERN_INFO "Group %d added to processor %d. Utilization: %u\n", group->id, group->cpu, new_task->util);
+    return 0;
+}
+
+static void remove_group_from_processor(struct reserve_group *group) {
+    struct bucket_task_ll *curr, **prev;
+
+    spin_lock(&processors_lock);
+    for (prev = &rtes_bucket(group->cpu)->first_task; (curr = *prev); prev = &curr->next) {
+        if (curr->group == group) {
+            *prev = curr->next;
+            rtes_bucket(group->cpu)->running_util -= curr->util;
+            rtes_bucket(group->cpu)->num_tasks--;
+            kfree(curr);
+            break;
+        }
+    }
+    spin_unlock(&processors_lock);
 }
 
-// Remove task from processor bucket
+// Remove task from processor bucket, from every processor holding a portion of a split task
 void remove_task_from_processor(struct task_struct *task) {
     int i;
+    bool found = false;
     struct bucket_task_ll *curr, *prev;
-    for (i = 0; i < MAX_PROCESSORS; i++) {
-        spin_lock(&processors_lock); // Protect access to processors array
+    for_each_possible_cpu(i) {
+        spin_lock(&processors_lock); // Protect access to the processor buckets
         prev = NULL;
-        curr = processors[i].first_task;
+        curr = rtes_bucket(i)->first_task;
         printk(KERN_DEBUG "Checking processor %d for task %d\n", i, task->pid);
 
         while (curr) {
@@ -575,18 +954,18 @@ void remove_task_from_processor(struct task_struct *task) {
                 if (prev) {
                     prev->next = curr->next;
                 } else {
-                    processors[i].first_task = curr->next;
+                    rtes_bucket(i)->first_task = curr->next;
                 }
 
                 // Update processor utilization and task count
-                processors[i].running_util -= curr->util;
-                processors[i].num_tasks--;
+                rtes_bucket(i)->running_util -= curr->util;
+                rtes_bucket(i)->num_tasks--;
                 kfree(curr);
                 printk(KERN_INFO "Task %d removed from processor %d\n", task->pid, i);
                 spin_unlock(&processors_lock);
 
                 // Check if processor is now unused and turn it off
-                if (processors[i].num_tasks == 0) {
+                if (rtes_bucket(i)->num_tasks == 0) {
                     printk(KERN_INFO "Processor %d is now unused. Attempting to turn off.\n", i);
                     if (i != 0 && cpu_online(i)) { // Keep processor 0 always online
                         if (cpu_down(i)) {
@@ -597,186 +976,1256 @@ void remove_task_from_processor(struct task_struct *task) {
                     }
                 }
                 // turn_off_unused_processors()
-                print_processor_info(0);
-                print_processor_info(1);
-                print_processor_info(2);
-                print_processor_info(3);
-                return;
+                print_processors_info();
+                found = true;
+                goto next_processor;
             }
             prev = curr;
             curr = curr->next;
         }
         spin_unlock(&processors_lock);
+next_processor:
+        ;
     }
-    printk(KERN_ERR "Task %d not found in any processor bucket\n", task->pid);
+    if (!found)
+        printk(KERN_ERR "Task %d not found in any processor bucket\n", task->pid);
 }
 
-SYSCALL_DEFINE4(set_reserve, pid_t, pid, struct timespec __user *, C, struct timespec __user *, T, int, cpuid) {
+/**
+ * Switch a reserved task to SCHED_FIFO at the given priority, keeping what it had before
+ * so that restore_task_sched() can put it back when the reservation is cancelled.
+ */
+static int set_task_sched(struct task_struct *task, unsigned int rt_priority) {
+    struct reservation_data *res_data = task->reservation_data;
+    struct sched_param param = { .sched_priority = rt_priority };
+
+    if (!res_data->sched_saved) {
+        res_data->orig_policy = task->policy;
+        res_data->orig_rt_priority = task->rt_priority;
+        res_data->sched_saved = true;
+    }
+    return sched_setscheduler_nocheck(task, SCHED_FIFO, &param);
+}
+
+static void restore_task_sched(struct task_struct *task) {
+    struct reservation_data *res_data = task->reservation_data;
+    struct sched_param param;
+
+    if (!res_data->sched_saved)
+        return;
+
+    param.sched_priority = res_data->orig_rt_priority;
+    if (sched_setscheduler_nocheck(task, res_data->orig_policy, &param))
+        printk(KERN_ERR "Failed to restore the scheduling policy of PID %d\n", task->pid);
+    res_data->sched_saved = false;
+}
+
+/**
+ * Rate-monotonic priority assignment
+ *  In RM mode the reserved tasks of a cpu get SCHED_FIFO priorities in deadline order, evenly spaced over
+ *  [RTES_RM_PRIO_MIN, RTES_RM_PRIO_MAX] so that the runtime order is the order check_schedulability()
+ *  assumed. The whole cpu is re-spaced whenever a task is admitted or cancelled. The original policy is
+ *  restored on cancel. Disabled with /sys/rtes/config/assign_priorities = 0. Split tasks run above the band
+ *  at RTES_SPLIT_PRIO and are left alone.
+ */
+unsigned int assign_priorities = 1;
+static DEFINE_MUTEX(priority_mutex);
+
+struct prio_assignment {
     struct task_struct *task;
+    u64 key;
+    int group_id;                   // 0 when not in a group
+    unsigned int old_prio;
+    unsigned int new_prio;
+};
+
+// Order of the tasks on a cpu, shortest deadline first (deadline-monotonic, rate-monotonic when D = T)
+static u64 priority_key(struct reservation_data *res_data) {
+    return timespec_to_ns(&res_data->reserve_D);
+}
+
+static void assign_rm_priorities(int cpuid) {
+    struct prio_assignment tasks[MAX_TASKS], tmp;
     struct reservation_data *res_data;
-    struct timespec c, t;
-    int ret, processor_id;
-    cpumask_t cpumask;
-    uint32_t util;
+    struct reserved_task *node;
+    int i, j, n = 0, step;
 
-    // ensure cpuid is valid
-    if (cpuid < -1 || cpuid > 3) {
-        return -EINVAL;
+    if (!assign_priorities || current_sched_policy != RTES_RM)
+        return;
+
+    mutex_lock(&priority_mutex);
+
+    // Snapshot the reserved tasks of the cpu
+    spin_lock(&reserved_tasks_list_lock);
+    list_for_each_entry(node, &reserved_tasks_list, list) {
+        res_data = node->task->reservation_data;
+        if (res_data->reserve_cpu == cpuid && !res_data->split.parts && n < MAX_TASKS) {
+            get_task_struct(node->task);
+            tasks[n].task = node->task;
+            tasks[n].key = priority_key(res_data);
+            tasks[n].group_id = res_data->group ? res_data->group->id : 0;
+            tasks[n].old_prio = (node->task->policy == SCHED_FIFO || node->task->policy == SCHED_RR) ?
+                                node->task->rt_priority : 0;
+            n++;
+        }
     }
+    spin_unlock(&reserved_tasks_list_lock);
 
-    // copy reservation params from user space
-    if(copy_from_user(&c, C, sizeof(struct timespec)) || copy_from_user(&t, T, sizeof(struct timespec))) {
-        return -EFAULT;
+    // Sort by deadline, ties broken by group then pid so that the members of a group are next to each other
+    // and the order is stable across re-spacings
+    for (i = 0; i < n - 1; i++) {
+        for (j = i + 1; j < n; j++) {
+            if (tasks[j].key < tasks[i].key ||
+                (tasks[j].key == tasks[i].key && tasks[j].group_id < tasks[i].group_id) ||
+                (tasks[j].key == tasks[i].key && tasks[j].group_id == tasks[i].group_id &&
+                 tasks[j].task->pid < tasks[i].task->pid)) {
+                tmp = tasks[i];
+                tasks[i] = tasks[j];
+                tasks[j] = tmp;
+            }
+        }
     }
 
-    // ensure non-negative c and t
-    if (c.tv_sec < 0 || t.tv_sec < 0 || c.tv_nsec < 0 || t.tv_nsec < 0) {
-        return -EINVAL;
+    step = n > 1 ? (RTES_RM_PRIO_MAX - RTES_RM_PRIO_MIN) / (n - 1) : 0;
+    for (i = 0; i < n; i++)
+        tasks[i].new_prio = RTES_RM_PRIO_MAX - i * step;
+
+    /**
+     * The priorities are changed one task at a time, so order the changes such that two tasks of the cpu
+     * are never inverted in between: tasks moving down go first, lowest first, then tasks moving up,
+     * highest first.
+     */
+    for (i = n - 1; i >= 0; i--) {
+        if (tasks[i].new_prio < tasks[i].old_prio && set_task_sched(tasks[i].task, tasks[i].new_prio))
+            printk(KERN_ERR "Failed to set the priority of PID %d\n", tasks[i].task->pid);
     }
-    
+    for (i = 0; i < n; i++) {
+        if (tasks[i].new_prio > tasks[i].old_prio && set_task_sched(tasks[i].task, tasks[i].new_prio))
+            printk(KERN_ERR "Failed to set the priority of PID %d\n", tasks[i].task->pid);
+        put_task_struct(tasks[i].task);
+    }
+
+    mutex_unlock(&priority_mutex);
+}
+
+/**
+ * Admit the reservation (C, T, D) for the task and start enforcing it
+ * @param task the caller must hold a reference to the task
+ * @param attr validated parameters, see check_reserve_attr(); attr->type is how the budget is replenished,
+ *             admission is the same for all types
+ * @param cpuid cpu to pin to, or -1 to pick one with the current partition policy
+ * @param split_ok whether a task that fits on no cpu may be split, see split.c
+ * Called with bin_packing_mutex held, see do_set_reserve().
+ */
+static long __do_set_reserve(struct task_struct *task, struct reserve_attr *attr, int cpuid, bool split_ok) {
+    struct reservation_data *res_data;
+    struct timespec c = attr->C, t = attr->T, d = attr->D;
+    enum reserve_type type = attr->type;
+    struct split_plan plan;
+    bool split = false;
+    u64 first_release_ns;
+    int ret, processor_id, i;
+    cpumask_t cpumask;
+    uint32_t util;
+
     // util (1000)
     util = div_C_T(timespec_to_ns(&c), timespec_to_ns(&t));
 
 
-    if (cpuid == -1) { 
+    // A member of a group has to leave it first
+    if (task->reservation_data && task->reservation_data->group) {
+        return -EBUSY;
+    }
+    // So does a reserved thread its reservation, only the profile mode replaces its own here
+    if (task->reservation_data && task->reservation_data->has_reservation &&
+        !task->reservation_data->profiling) {
+        return -EBUSY;
+    }
+
+    // Global and partitioned reservations are not mixed
+    if (has_reservations(cpuid != RTES_GLOBAL_CPU, task)) {
+        printk(KERN_ERR "Task %d: cannot mix global and partitioned reservations.\n", task->pid);
+        return -EBUSY;
+    }
+
+    if (cpuid == RTES_GLOBAL_CPU) {
+        if (current_sched_policy != RTES_RM) {
+            return -EINVAL;
+        }
+        processor_id = RTES_GLOBAL_CPU;
+        // Every cpu that can be brought online, the test is for the cpus the thread may run on
+        cpumask_clear(&cpumask);
+        for_each_possible_cpu(i) {
+            if (turn_on_processor(i))
+                cpumask_set_cpu(i, &cpumask);
+        }
+        if (global_schedulability_test(c, t, d, task, cpumask_weight(&cpumask)) < 0) {
+            printk(KERN_ERR "Task %d cannot be admitted globally.\n", task->pid);
+            rtes_event(RTES_EVENT_REJECT, task, RTES_GLOBAL_CPU, timespec_to_ns(&c));
+            return -EBUSY;
+        }
+    } else if (cpuid == -1) { 
         // Handle bin-packing case
-        mutex_lock(&bin_packing_mutex);
-        processor_id = find_best_processor(util, current_policy, c, t); 
+        processor_id = find_best_processor(util, current_policy, c, t, d);
+        // Fits on no single cpu: semi-partitioned mode splits it across cpus
+        if (processor_id < 0 && split_ok && semi_partitioned && current_sched_policy == RTES_RM &&
+            type == RESERVE_PERIODIC && timespec_to_ns(&attr->offset) == 0 &&
+            find_split(c, t, d, &plan) == 0) {
+            split = true;
+            processor_id = plan.cpu[0];
+            printk(KERN_INFO "Semi-partitioned: Task %d split into %d portions\n", task->pid, plan.parts);
+        }
         if (processor_id < 0) {
-            // spin_unlock(&processors_lock);
-            printk(KERN_ERR "Task %d cannot be assigned to any processor.\n", pid);
-            mutex_unlock(&bin_packing_mutex);
+            printk(KERN_ERR "Task %d cannot be assigned to any processor.\n", task->pid);
+            rtes_event(RTES_EVENT_REJECT, task, -1, timespec_to_ns(&c));
             return -EBUSY;
         }
-        // if (processor_id >= 0) {
-        //     add_task_to_processor(task, C, T, processor_id);
-        // }
-        mutex_unlock(&bin_packing_mutex);
-        printk(KERN_INFO "Bin packing: Task %d assigned to processor %d\n", pid, processor_id);
-    } else if (cpuid < -1|| cpuid >= MAX_PROCESSORS) {
-        // spin_unlock(&processors_lock);
+        printk(KERN_INFO "Bin packing: Task %d assigned to processor %d\n", task->pid, processor_id);
+    } else if (!rtes_cpu_valid(cpuid)) {
         return -EINVAL; // Invalid CPU ID
     } else {
         processor_id = cpuid; // Single processor specified
-        spin_lock(&processors_lock);
         // Check schedulability before adding
-        if (check_schedulability(processor_id, c, t) < 0){
-            spin_unlock(&processors_lock);
-            printk(KERN_ERR "Task %d cannot be assigned to processor %d.\n", pid, processor_id);
+        if (check_schedulability(processor_id, c, t, d, NULL) < 0){
+            printk(KERN_ERR "Task %d cannot be assigned to processor %d.\n", task->pid, processor_id);
+            rtes_event(RTES_EVENT_REJECT, task, processor_id, timespec_to_ns(&c));
             return -EBUSY;
         }
-        spin_unlock(&processors_lock);
-    }
-    // spin_lock(&processors_lock);
-    // // Check schedulability before adding
-    // if (check_schedulability(processor_id, c, t) < 0){
-    //     spin_unlock(&processors_lock);
-    //     printk(KERN_ERR "Task %d cannot be assigned to processor %d.\n", pid, processor_id);
-    //     return -EBUSY;
-    // }
-    // spin_unlock(&processors_lock);
-
-
-    // retrieve the task struct
-    if (pid == 0) {
-        task = current;
-    } else {
-        rcu_read_lock();
-        task = find_task_by_vpid(pid);
-        if(!task) {
-            rcu_read_unlock();
-            return -ESRCH; //no such process
-        }
-        get_task_struct(task);      // increase the ref count to prevent task being freed
-        rcu_read_unlock();
     }
 
     if (!task->reservation_data) {
         res_data = create_reservation_data(task);
         if (!res_data) {
-            if (pid != 0) {
-                put_task_struct(task);
-            }
             return -ENOMEM;
         }
     } else {
+        // Not reserved, or profiling, which is in no bucket and not in the reserved tasks list
         res_data = task->reservation_data;
         hrtimer_cancel(&res_data->reservation_timer);  // Cancel existing timer if present
+        cbs_stop(res_data);
+        split_stop(res_data);
+        reclaim_stop(res_data);
+        overrun_stop(res_data);
     }
 
     // inti monitoring data
     res_data->reserve_C = c;
     res_data->reserve_T = t;
+    res_data->reserve_D = d;
+    res_data->reserve_offset = attr->offset;
     res_data->has_reservation = true;
+    res_data->profiling = false;
+    res_data->adaptive = false;
+    res_data->reserve_cpu = processor_id;
+    res_data->reserve_type = type;
+    res_data->split.parts = 0;
+    if (split) {
+        res_data->split = plan;
+    }
+    res_data->split_idx = 0;
+    res_data->split_base_ns = 0;
     res_data->task = task;
     res_data->monitoring_enabled = taskmon_enabled;
 
     // Create sysfs file regardless of taskmon_enabled
-    if (!res_data->taskmon_tid_attr) {
-        ret = create_tid_file(task);
-        if (ret) {
-            printk(KERN_ERR "set_reserve: Failed to create tid file for PID %d with error %d\n", task->pid, ret);
-            res_data->has_reservation = false;
-            if (pid != 0) {
-                put_task_struct(task);
-            }
-            return ret;
-        }
+    ret = create_tid_file(task);
+    if (ret) {
+        printk(KERN_ERR "set_reserve: Failed to create tid file for PID %d with error %d\n", task->pid, ret);
+        goto fail;
+    }
+
+    // Create /sys/rtes/tasks/<pid> for the job statistics
+    reset_job_stats(res_data);
+    reset_exec_stats(res_data);
+    ret = create_task_dir(task);
+    if (ret) {
+        printk(KERN_ERR "set_reserve: Failed to create task directory for PID %d with error %d\n", task->pid, ret);
+        goto fail;
     }
 
     res_data->exec_accumulated_time = 0;
     getrawmonotonic(&(res_data->exec_start_time)); // Init exec start time to now
+    cbs_start(res_data);
+
+    // With an offset the first job is released by the timer, until then the thread is suspended when it
+    // is switched out (see context_switch)
+    res_data->offset_pending = timespec_to_ns(&attr->offset) > 0 && type == RESERVE_PERIODIC;
+    first_release_ns = timespec_to_ns(&attr->offset);
   
-    // set specified cpu
-    cpumask_clear(&cpumask);
-    cpumask_set_cpu(processor_id, &cpumask);
+    // set specified cpu, global mode already has the mask it was admitted on
+    if (processor_id != RTES_GLOBAL_CPU) {
+        // Online before processors_lock is taken, cpu_up sleeps
+        for (i = 0; split && i < plan.parts; i++)
+            turn_on_processor(plan.cpu[i]);
+        turn_on_processor(processor_id);
+        cpumask_clear(&cpumask);
+        cpumask_set_cpu(processor_id, &cpumask);
+    }
     ret = set_cpus_allowed_ptr(task, &cpumask); // user kernel space func to set task's cpu affinity
     if (ret) {
         printk(KERN_ERR "Failed to set CPU affinity for PID %d\n", task->pid);
-        if (pid != 0) {
-            put_task_struct(task);  //decrease the ref count
-        }
-        return ret;
+        goto fail;
     }
     
-    // Add task to the processor
+    // Add task to the processor, or each portion to its processor
     spin_lock(&processors_lock);
-    add_task_to_processor(task, c, t, processor_id);
+    if (split) {
+        for (i = 0; i < plan.parts; i++) {
+            add_task_to_processor(task, plan.C[i], t, plan.cpu[i]);
+        }
+    } else if (processor_id != RTES_GLOBAL_CPU) {
+        add_task_to_processor(task, c, t, processor_id);
+    }
     spin_unlock(&processors_lock);
+
+    // EDF mode: first job due one period from now, ordered by deadline at the shared EDF priority
+    res_data->edf = false;
+    if (current_sched_policy == RTES_EDF) {
+        res_data->edf_deadline_ns = ktime_to_ns(ktime_get()) + first_release_ns + timespec_to_ns(&d);
+        res_data->edf = true;
+        if (set_task_sched(task, RTES_EDF_PRIO)) {
+            printk(KERN_ERR "Failed to set the EDF priority for PID %d\n", task->pid);
+        }
+    }
     
     // initialize a high resolution timer trigger periodically T units
     hrtimer_init(&res_data->reservation_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
     res_data->reservation_timer.function = reservation_timer_callback;
     res_data->task = task;  // Link task to reservation data for callback
-    hrtimer_start(&res_data->reservation_timer, ktime_set(0, timespec_to_ns(&t)), HRTIMER_MODE_REL);
-    
-
-    if (pid != 0) 
-        put_task_struct(task);
+    hrtimer_start(&res_data->reservation_timer,
+                  ktime_set(0, first_release_ns ? first_release_ns : timespec_to_ns(&t)), HRTIMER_MODE_REL);
+    if (split) {
+        split_start(res_data, ktime_to_ns(ktime_get()));
+        if (set_task_sched(task, RTES_SPLIT_PRIO)) {
+            printk(KERN_ERR "Failed to set the split priority for PID %d\n", task->pid);
+        }
+    }
 
     // Add to the reserved tasks list
     add_task_to_list(task);
 
-    printk(KERN_INFO "set_reserve called: pid=%d, C=%ld.%09ld, T=%ld.%09ld, cpuid=%d\n",
-           pid, c.tv_sec, c.tv_nsec, t.tv_sec, t.tv_nsec, cpuid);
+    // RM mode: the new task gets its place in the period order of the cpu
+    assign_rm_priorities(processor_id);
+
+    printk(KERN_INFO "set_reserve called: pid=%d, C=%ld.%09ld, T=%ld.%09ld, D=%ld.%09ld, cpuid=%d, type=%s\n",
+           task->pid, c.tv_sec, c.tv_nsec, t.tv_sec, t.tv_nsec, d.tv_sec, d.tv_nsec, cpuid,
+           type == RESERVE_CBS ? "CBS" : "periodic");
+    rtes_event(RTES_EVENT_ADMIT, task, processor_id, timespec_to_ns(&c));
 
     return 0;
+
+fail:
+    // Nothing is in a bucket or the reserved tasks list yet
+    cbs_stop(res_data);
+    remove_task_dir(task);
+    remove_tid_file(task);
+    res_data->offset_pending = false;
+    res_data->split.parts = 0;
+    res_data->has_reservation = false;
+    return ret;
 }
 
+/**
+ * Admission and insertion are one step: bin_packing_mutex is held from the schedulability test until the
+ * task is in the processor bucket and the reserved tasks list, so two admissions, or an admission and a
+ * budget increase of the adaptive controller, never both pass against the same task set.
+ * Shared by the set_reserve syscalls and the profile mode when it applies its budget.
+ */
+static long do_set_reserve(struct task_struct *task, struct reserve_attr *attr, int cpuid) {
+    long ret;
 
-//remove the thread
-SYSCALL_DEFINE1(cancel_reserve, pid_t, pid) {
-    struct task_struct *task;
-    struct reservation_data *res_data;
-    // retrieve the task
-    if (pid == 0) {
-        task = current;
-    } else {
-        rcu_read_lock();
-        task = find_task_by_vpid(pid);
-        if (!task) {
-            rcu_read_unlock();
-            return -ESRCH;
+    mutex_lock(&bin_packing_mutex);
+    ret = __do_set_reserve(task, attr, cpuid, true);
+    mutex_unlock(&bin_packing_mutex);
+    return ret;
+}
+
+// Validate reservation parameters copied from user space
+static int check_reserve_attr(struct reserve_attr *attr) {
+    if (attr->type < RESERVE_PERIODIC || attr->type >= RESERVE_TYPE_MAX) {
+        return -EINVAL;
+    }
+
+    // ensure non-negative, normalized c, t, d and offset
+    if (!timespec_valid(&attr->C) || !timespec_valid(&attr->T) || !timespec_valid(&attr->D) ||
+        !timespec_valid(&attr->offset)) {
+        return -EINVAL;
+    }
+
+    // constrained deadlines only: 0 < D <= T
+    if (timespec_to_ns(&attr->D) == 0 || timespec_compare(&attr->D, &attr->T) > 0) {
+        return -EINVAL;
+    }
+
+    // the first job is released within the first period, 0 <= offset < T
+    if (timespec_compare(&attr->offset, &attr->T) >= 0) {
+        return -EINVAL;
+    }
+
+    // a server without budget would never run
+    if (attr->type == RESERVE_CBS && timespec_to_ns(&attr->C) == 0) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// Common part of the set_reserve syscalls
+static long set_reserve_attr(pid_t pid, struct reserve_attr *attr, int cpuid) {
+    struct task_struct *task;
+    long ret;
+
+    // ensure cpuid is valid, -2 for global mode
+    if (cpuid < RTES_GLOBAL_CPU || (cpuid >= 0 && !rtes_cpu_valid(cpuid))) {
+        return -EINVAL;
+    }
+
+    ret = check_reserve_attr(attr);
+    if (ret) {
+        return ret;
+    }
+
+    // retrieve the task struct
+    if (pid == 0) {
+        task = current;
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if(!task) {
+            rcu_read_unlock();
+            return -ESRCH; //no such process
+        }
+        get_task_struct(task);      // increase the ref count to prevent task being freed
+        rcu_read_unlock();
+    }
+
+    ret = do_set_reserve(task, attr, cpuid);
+
+    if (pid != 0) 
+        put_task_struct(task);
+
+    return ret;
+}
+
+SYSCALL_DEFINE4(set_reserve, pid_t, pid, struct timespec __user *, C, struct timespec __user *, T, int, cpuid) {
+    return sys_set_reserve_type(pid, C, T, cpuid, RESERVE_PERIODIC);
+}
+
+/**
+ * set_reserve with the replenishment type: RESERVE_PERIODIC (0) behaves as set_reserve,
+ * RESERVE_CBS (1) makes the reservation a Constant Bandwidth Server (see cbs.c)
+ */
+SYSCALL_DEFINE5(set_reserve_type, pid_t, pid, struct timespec __user *, C, struct timespec __user *, T, int, cpuid,
+                int, type) {
+    struct reserve_attr attr;
+
+    // copy reservation params from user space
+    if(copy_from_user(&attr.C, C, sizeof(struct timespec)) || copy_from_user(&attr.T, T, sizeof(struct timespec))) {
+        return -EFAULT;
+    }
+    attr.D = attr.T;
+    attr.offset = (struct timespec){0, 0};
+    attr.type = type;
+
+    return set_reserve_attr(pid, &attr, cpuid);
+}
+
+/**
+ * set_reserve with a relative deadline D <= T and a release offset, see struct reserve_attr
+ * A zero D means D = T.
+ */
+SYSCALL_DEFINE3(set_reserve_ex, pid_t, pid, struct reserve_attr __user *, uattr, int, cpuid) {
+    struct reserve_attr attr;
+
+    if (copy_from_user(&attr, uattr, sizeof(struct reserve_attr))) {
+        return -EFAULT;
+    }
+    if (attr.D.tv_sec == 0 && attr.D.tv_nsec == 0) {
+        attr.D = attr.T;
+    }
+
+    return set_reserve_attr(pid, &attr, cpuid);
+}
+
+/**
+ * Choose what happens when the reservation of pid uses up its budget, see overrun.c
+ * Setting or cancelling the reservation goes back to RTES_OVERRUN_THROTTLE. RTES_OVERRUN_BORROW is
+ * rejected with -EBUSY if the cpu of the reservation does not pass the admission test with 2C.
+ */
+SYSCALL_DEFINE2(set_overrun_policy, pid_t, pid, int, policy) {
+    struct task_struct *task;
+    struct reservation_data *res_data;
+    struct timespec c2;
+    long ret = 0;
+
+    if (pid == 0) {
+        task = current;
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if (!task) {
+            rcu_read_unlock();
+            return -ESRCH;
+        }
+        get_task_struct(task);
+        rcu_read_unlock();
+    }
+
+    res_data = task->reservation_data;
+    if (!res_data || !res_data->has_reservation || res_data->reserve_type != RESERVE_PERIODIC ||
+        res_data->group) {
+        ret = -EINVAL;   // Members of a group are throttled with the group
+    } else {
+        // Admission and the policy change are one step, as in do_set_reserve
+        mutex_lock(&bin_packing_mutex);
+        if (policy == RTES_OVERRUN_BORROW && !res_data->split.parts) {
+            c2 = ns_to_timespec(2 * timespec_to_ns(&res_data->reserve_C));
+            if (res_data->reserve_cpu == RTES_GLOBAL_CPU)
+                ret = global_schedulability_test(c2, res_data->reserve_T, res_data->reserve_D, task,
+                                                 cpumask_weight(&task->cpus_allowed));
+            else
+                ret = check_schedulability(res_data->reserve_cpu, c2, res_data->reserve_T,
+                                           res_data->reserve_D, task);
+            if (ret < 0)
+                ret = -EBUSY;
+        }
+        if (!ret)
+            ret = overrun_set_policy(res_data, policy);
+        mutex_unlock(&bin_packing_mutex);
+    }
+
+    if (pid != 0)
+        put_task_struct(task);
+    return ret;
+}
+
+/**
+ * Declare the longest critical section cs of the reserved thread pid on a PI futex shared with other
+ * reserved threads of its cpu, see blocking.c. The task set of the cpu is checked again with the blocking
+ * it adds to the higher priority tasks, and the declaration is rejected with -EBUSY if that fails.
+ */
+SYSCALL_DEFINE2(set_reserve_blocking, pid_t, pid, struct timespec __user *, cs) {
+    struct task_struct *task;
+    struct reservation_data *res_data;
+    struct timespec cs_k;
+    u64 old_ns;
+    long ret = 0;
+
+    if (copy_from_user(&cs_k, cs, sizeof(struct timespec))) {
+        return -EFAULT;
+    }
+    if (!timespec_valid(&cs_k)) {
+        return -EINVAL;
+    }
+
+    if (pid == 0) {
+        task = current;
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if (!task) {
+            rcu_read_unlock();
+            return -ESRCH;
+        }
+        get_task_struct(task);
+        rcu_read_unlock();
+    }
+
+    // Admission and the declaration are one step, as in do_set_reserve
+    mutex_lock(&bin_packing_mutex);
+    res_data = task->reservation_data;
+    // Partitioned reservations only, groups and split tasks are analysed without critical sections
+    if (!res_data || !res_data->has_reservation || res_data->group || res_data->split.parts ||
+        !rtes_cpu_valid(res_data->reserve_cpu) ||
+        timespec_compare(&cs_k, &res_data->reserve_C) > 0) {
+        mutex_unlock(&bin_packing_mutex);
+        ret = -EINVAL;
+        goto out;
+    }
+
+    old_ns = res_data->block_declared_ns;
+    res_data->block_declared_ns = timespec_to_ns(&cs_k);
+    if (check_schedulability(res_data->reserve_cpu, res_data->reserve_C, res_data->reserve_T,
+                             res_data->reserve_D, task) < 0) {
+        res_data->block_declared_ns = old_ns;
+        ret = -EBUSY;
+    }
+    mutex_unlock(&bin_packing_mutex);
+
+    if (!ret) {
+        printk(KERN_INFO "set_reserve_blocking: PID %d, cs=%ld.%09ld\n", task->pid, cs_k.tv_sec, cs_k.tv_nsec);
+    }
+
+out:
+    if (pid != 0)
+        put_task_struct(task);
+    return ret;
+}
+
+/**
+ * Group reservations, see group.c
+ *  group_mutex serializes creating and destroying groups with members joining and leaving, so a member
+ *  never points to a freed group. The cgroup attach path takes it under cgroup_mutex, and bringing a cpu
+ *  online takes cgroup_mutex in the cpuset hotplug handler, so no cpu is brought up or down with
+ *  group_mutex held. The order is bin_packing_mutex, cgroup_mutex, group_mutex.
+ */
+static DEFINE_MUTEX(group_mutex);
+
+// Take a member out of its group and give it back its affinity and scheduling, group_mutex must be held
+static void cancel_group_member(struct task_struct *task, bool exiting) {
+    struct reservation_data *res_data = task->reservation_data;
+
+    reserve_group_del(res_data);
+    remove_task_from_list(task);
+    res_data->has_reservation = false;
+    res_data->reserve_C = (struct timespec){0, 0};
+    res_data->reserve_T = (struct timespec){0, 0};
+    if (!exiting) {
+        restore_task_sched(task);
+        set_cpus_allowed_ptr(task, cpu_all_mask);
+    }
+}
+
+// Called by an exiting member of a group
+void reserve_group_exit(struct task_struct *task) {
+    mutex_lock(&group_mutex);
+    if (task->reservation_data->group) {
+        cancel_group_member(task, true);
+    }
+    mutex_unlock(&group_mutex);
+}
+
+/**
+ * Create a group reservation with budget c every period t on cpuid, or on the cpu chosen by the partition
+ * policy with -1. The group is admitted as a single task. Returns the id of the group.
+ * A group created for a cgroup (see rtes_cgroup.c) is only joined and destroyed through it.
+ */
+long do_create_reserve_group(struct timespec c, struct timespec t, int cpuid, bool cgroup) {
+    struct reserve_attr attr;
+    struct reserve_group *group;
+    uint32_t util;
+    int processor_id, ret;
+
+    attr.C = c;
+    attr.T = t;
+    attr.D = attr.T;
+    attr.offset = (struct timespec){0, 0};
+    attr.type = RESERVE_PERIODIC;
+    ret = check_reserve_attr(&attr);
+    if (ret) {
+        return ret;
+    }
+
+    if (cpuid < -1 || (cpuid >= 0 && !rtes_cpu_valid(cpuid))) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&bin_packing_mutex);
+    // Groups are analysed as one fixed-priority task of a single cpu
+    if (current_sched_policy != RTES_RM) {
+        mutex_unlock(&bin_packing_mutex);
+        return -EINVAL;
+    }
+    if (has_reservations(true, NULL)) {
+        mutex_unlock(&bin_packing_mutex);
+        return -EBUSY;
+    }
+    if (cpuid == -1) {
+        util = div_C_T(timespec_to_ns(&attr.C), timespec_to_ns(&attr.T));
+        processor_id = find_best_processor(util, current_policy, attr.C, attr.T, attr.D);
+    } else {
+        processor_id = check_schedulability(cpuid, attr.C, attr.T, attr.D, NULL) < 0 ? -1 : cpuid;
+    }
+    if (processor_id < 0 || !turn_on_processor(processor_id)) {
+        mutex_unlock(&bin_packing_mutex);
+        printk(KERN_ERR "Group reservation cannot be assigned to any processor.\n");
+        return -EBUSY;
+    }
+
+    mutex_lock(&group_mutex);
+    group = reserve_group_create(attr.C, attr.T, processor_id);
+    if (!group) {
+        ret = -ENOMEM;
+    } else {
+        group->cgroup = cgroup;
+        ret = add_group_to_processor(group);
+        if (ret) {
+            reserve_group_free(group);
+        }
+    }
+    mutex_unlock(&group_mutex);
+    mutex_unlock(&bin_packing_mutex);
+    if (ret) {
+        return ret;
+    }
+
+    printk(KERN_INFO "create_reserve_group: group=%d, C=%ld.%09ld, T=%ld.%09ld, cpuid=%d\n", group->id,
+           attr.C.tv_sec, attr.C.tv_nsec, attr.T.tv_sec, attr.T.tv_nsec, processor_id);
+    return group->id;
+}
+
+SYSCALL_DEFINE3(create_reserve_group, struct timespec __user *, C, struct timespec __user *, T, int, cpuid) {
+    struct timespec c, t;
+
+    if (copy_from_user(&c, C, sizeof(struct timespec)) || copy_from_user(&t, T, sizeof(struct timespec))) {
+        return -EFAULT;
+    }
+    return do_create_reserve_group(c, t, cpuid, false);
+}
+
+// Make task a member of group id, the thread must not have a reservation of its own
+long do_join_reserve_group(struct task_struct *task, int id, bool cgroup) {
+    struct reservation_data *res_data;
+    struct reserve_group *group;
+    long ret = 0;
+
+    // The group is one RM task of its cpu, see do_create_reserve_group
+    if (current_sched_policy != RTES_RM) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&group_mutex);
+    group = reserve_group_find(id);
+    if (!group) {
+        ret = -EINVAL;
+        goto out;
+    }
+    if (group->cgroup && !cgroup) {
+        ret = -EBUSY;   // Members are the tasks of the cgroup
+        goto out;
+    }
+    if (task->reservation_data && task->reservation_data->has_reservation) {
+        ret = -EBUSY;
+        goto out;
+    }
+
+    res_data = task->reservation_data;
+    if (!res_data) {
+        res_data = create_reservation_data(task);
+        if (!res_data) {
+            ret = -ENOMEM;
+            goto out;
+        }
+        // Never started for a member, initialized so that cancelling it is a no-op
+        hrtimer_init(&res_data->reservation_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    }
+
+    ret = set_cpus_allowed_ptr(task, cpumask_of(group->cpu));
+    if (ret) {
+        printk(KERN_ERR "Failed to set CPU affinity for PID %d\n", task->pid);
+        goto out;
+    }
+
+    res_data->reserve_C = group->C;
+    res_data->reserve_T = group->T;
+    res_data->reserve_D = group->D;
+    res_data->reserve_offset = (struct timespec){0, 0};
+    res_data->offset_pending = false;
+    res_data->reserve_cpu = group->cpu;
+    res_data->reserve_type = RESERVE_PERIODIC;
+    res_data->profiling = false;
+    res_data->adaptive = false;
+    res_data->edf = false;
+    res_data->split.parts = 0;
+    res_data->task = task;
+    res_data->exec_accumulated_time = 0;
+    getrawmonotonic(&res_data->exec_start_time);
+    reset_job_stats(res_data);
+    reset_exec_stats(res_data);
+
+    // do_exit checks for a reservation after setting PF_EXITING and taking the task lock, so an exiting
+    // task either leaves the group there or is never added
+    task_lock(task);
+    if (task->flags & PF_EXITING) {
+        task_unlock(task);
+        ret = -ESRCH;
+        goto out;
+    }
+    reserve_group_add(group, res_data);
+    res_data->has_reservation = true;
+    task_unlock(task);
+
+    add_task_to_list(task);
+    assign_rm_priorities(group->cpu);
+    printk(KERN_INFO "join_reserve_group: pid=%d joined group %d\n", task->pid, id);
+
+out:
+    mutex_unlock(&group_mutex);
+    return ret;
+}
+
+SYSCALL_DEFINE2(join_reserve_group, pid_t, pid, int, id) {
+    struct task_struct *task;
+    long ret;
+
+    if (pid == 0) {
+        task = current;
+        get_task_struct(task);
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if (!task) {
+            rcu_read_unlock();
+            return -ESRCH;
+        }
+        get_task_struct(task);
+        rcu_read_unlock();
+    }
+
+    ret = do_join_reserve_group(task, id, false);
+    put_task_struct(task);
+    return ret;
+}
+
+// Take task out of its group, with cgroup only if that group belongs to a cgroup
+void do_leave_reserve_group(struct task_struct *task, bool cgroup) {
+    struct reservation_data *res_data = task->reservation_data;
+    int cpu;
+
+    mutex_lock(&group_mutex);
+    if (res_data && res_data->group && (!cgroup || res_data->group->cgroup)) {
+        cpu = res_data->group->cpu;
+        cancel_group_member(task, false);
+        mutex_unlock(&group_mutex);
+        assign_rm_priorities(cpu);
+        return;
+    }
+    mutex_unlock(&group_mutex);
+}
+
+// Take all members out of group id and give its bandwidth back
+long do_destroy_reserve_group(int id, bool cgroup) {
+    struct reserve_group *group;
+    struct reservation_data *res_data;
+    struct task_struct *task;
+    unsigned long flags;
+    int cpu;
+
+    mutex_lock(&group_mutex);
+    group = reserve_group_find(id);
+    if (!group) {
+        mutex_unlock(&group_mutex);
+        return -EINVAL;
+    }
+    if (group->cgroup && !cgroup) {
+        mutex_unlock(&group_mutex);
+        return -EBUSY;  // Goes away with its cgroup
+    }
+
+    for (;;) {
+        spin_lock_irqsave(&group->lock, flags);
+        if (list_empty(&group->members)) {
+            spin_unlock_irqrestore(&group->lock, flags);
+            break;
+        }
+        res_data = list_first_entry(&group->members, struct reservation_data, group_node);
+        task = res_data->task;
+        get_task_struct(task);
+        spin_unlock_irqrestore(&group->lock, flags);
+
+        cancel_group_member(task, false);
+        put_task_struct(task);
+    }
+
+    cpu = group->cpu;
+    remove_group_from_processor(group);
+    reserve_group_free(group);
+    mutex_unlock(&group_mutex);
+
+    assign_rm_priorities(cpu);
+    printk(KERN_INFO "destroy_reserve_group: group %d destroyed\n", id);
+    return 0;
+}
+
+SYSCALL_DEFINE1(destroy_reserve_group, int, id) {
+    return do_destroy_reserve_group(id, false);
+}
+
+// Copy the parameters and state of group id, returns -EINVAL if there is no such group
+int reserve_group_info(int id, struct reserve_group *info) {
+    struct reserve_group *group;
+    int ret = 0;
+
+    mutex_lock(&group_mutex);
+    group = reserve_group_find(id);
+    if (group) {
+        info->id = group->id;
+        info->C = group->C;
+        info->T = group->T;
+        info->D = group->D;
+        info->cpu = group->cpu;
+        info->nr_members = group->nr_members;
+        info->period_count = group->period_count;
+        info->throttled = group->throttled;
+        atomic64_set(&info->exec_ns, atomic64_read(&group->exec_ns));
+    } else {
+        ret = -EINVAL;
+    }
+    mutex_unlock(&group_mutex);
+    return ret;
+}
+
+/**
+ * Adaptive reservations
+ *  set_reserve_adaptive(pid, Cmin, Cmax, T, cpuid) admits the thread with budget Cmin, which stays
+ *  guaranteed. A per-CPU controller runs every /sys/rtes/config/adapt_interval_ms and moves the budget of
+ *  each adaptive reservation on its CPU toward the adapt_percentile percentile of the execution times seen
+ *  since its previous step plus adapt_headroom percent, within [Cmin, Cmax]. A budget only grows if the
+ *  whole task set of the CPU still passes check_schedulability() with it, so every other reservation keeps
+ *  its guarantee.
+ */
+unsigned int adapt_interval_ms = 1000;
+unsigned int adapt_percentile = 95;
+unsigned int adapt_headroom = 10;
+
+struct adapt_controller {
+    struct delayed_work work;
+    int cpu;
+};
+
+static DEFINE_PER_CPU(struct adapt_controller, adapt_controllers);
+
+// Schedule the next step of the controller of the cpu, no-op if one is already pending
+static void adapt_kick(int cpu) {
+    struct adapt_controller *ctl = &per_cpu(adapt_controllers, cpu);
+
+    schedule_delayed_work(&ctl->work, msecs_to_jiffies(adapt_interval_ms));
+}
+
+// Change the budget of an admitted task and its processor bucket entry, processors_lock must be held
+static void update_task_budget(struct task_struct *task, int cpuid, struct timespec c) {
+    struct reservation_data *res_data = task->reservation_data;
+    struct bucket_task_ll *curr;
+    uint32_t util = div_C_T(timespec_to_ns(&c), timespec_to_ns(&res_data->reserve_T));
+
+    for (curr = rtes_bucket(cpuid)->first_task; curr; curr = curr->next) {
+        if (curr->task == task) {
+            rtes_bucket(cpuid)->running_util = rtes_bucket(cpuid)->running_util - curr->util + util;
+            curr->util = util;
+            curr->cost = c;
+            break;
+        }
+    }
+    res_data->reserve_C = c;
+}
+
+// One controller step for one adaptive reservation, called with bin_packing_mutex held
+static void adapt_budget(struct task_struct *task, int cpuid) {
+    struct reservation_data *res_data = task->reservation_data;
+    u64 c_ns, target_ns, demand_us, samples, throttled;
+    struct timespec target;
+    unsigned long flags;
+
+    if (!res_data || !res_data->has_reservation || !res_data->adaptive)
+        return;
+
+    // Take the observations of the last interval and start a new window
+    spin_lock_irqsave(&res_data->exec.lock, flags);
+    samples = res_data->adapt_hist.count;
+    throttled = res_data->adapt_throttled;
+    demand_us = hist_percentile(&res_data->adapt_hist, adapt_percentile * 10);
+    memset(&res_data->adapt_hist, 0, sizeof(res_data->adapt_hist));
+    res_data->adapt_throttled = 0;
+    spin_unlock_irqrestore(&res_data->exec.lock, flags);
+
+    if (!samples)
+        return;
+
+    c_ns = timespec_to_ns(&res_data->reserve_C);
+    target_ns = div_u64(demand_us * 1000 * (100 + adapt_headroom), 100);
+    // Throttled periods hide the real demand, which is at least the budget, so grow past it
+    if (throttled * 100 > samples * (100 - adapt_percentile))
+        target_ns = max(target_ns, div_u64(c_ns * (100 + adapt_headroom), 100));
+    target_ns = clamp_t(u64, target_ns, timespec_to_ns(&res_data->adapt_C_min),
+                        timespec_to_ns(&res_data->adapt_C_max));
+
+    if (target_ns == c_ns)
+        return;
+    target = ns_to_timespec(target_ns);
+
+    spin_lock(&processors_lock);
+    // Shrinking is always safe, growing must keep the task set of the cpu schedulable
+    if (target_ns > c_ns &&
+        check_schedulability(cpuid, target, res_data->reserve_T, res_data->reserve_D, task) < 0) {
+        spin_unlock(&processors_lock);
+        printk(KERN_INFO "adaptive: PID %d budget kept at %llu ns, %llu ns is not schedulable on cpu%d\n",
+               task->pid, c_ns, target_ns, cpuid);
+        return;
+    }
+    update_task_budget(task, cpuid, target);
+    spin_unlock(&processors_lock);
+
+    printk(KERN_INFO "adaptive: PID %d budget %llu ns -> %llu ns\n", task->pid, c_ns, target_ns);
+}
+
+static void adapt_controller_fn(struct work_struct *work) {
+    struct adapt_controller *ctl = container_of(to_delayed_work(work), struct adapt_controller, work);
+    struct task_struct *tasks[MAX_TASKS];
+    struct bucket_task_ll *curr;
+    int i, n = 0;
+
+    // Snapshot the adaptive reservations on this cpu
+    spin_lock(&processors_lock);
+    for (curr = rtes_bucket(ctl->cpu)->first_task; curr && n < MAX_TASKS; curr = curr->next) {
+        if (curr->task && curr->task->reservation_data && curr->task->reservation_data->adaptive) {
+            get_task_struct(curr->task);
+            tasks[n++] = curr->task;
+        }
+    }
+    spin_unlock(&processors_lock);
+
+    // Serialize with admission so the analysis sees a stable task set
+    mutex_lock(&bin_packing_mutex);
+    for (i = 0; i < n; i++) {
+        adapt_budget(tasks[i], ctl->cpu);
+        put_task_struct(tasks[i]);
+    }
+    mutex_unlock(&bin_packing_mutex);
+
+    // Keep running while the cpu has adaptive reservations
+    if (n > 0)
+        adapt_kick(ctl->cpu);
+}
+
+SYSCALL_DEFINE5(set_reserve_adaptive, pid_t, pid, struct timespec __user *, Cmin, struct timespec __user *, Cmax,
+                struct timespec __user *, T, int, cpuid) {
+    struct task_struct *task;
+    struct reservation_data *res_data;
+    struct reserve_attr attr;
+    struct timespec c_min, c_max, t;
+    unsigned long flags;
+    long ret;
+
+    // ensure cpuid is valid
+    if (cpuid < -1 || (cpuid >= 0 && !rtes_cpu_valid(cpuid))) {
+        return -EINVAL;
+    }
+
+    if (copy_from_user(&c_min, Cmin, sizeof(struct timespec)) ||
+        copy_from_user(&c_max, Cmax, sizeof(struct timespec)) ||
+        copy_from_user(&t, T, sizeof(struct timespec))) {
+        return -EFAULT;
+    }
+
+    // The guaranteed part Cmin goes through the normal admission, 0 < T and Cmin <= Cmax <= T
+    attr = (struct reserve_attr){ .C = c_min, .T = t, .D = t, .type = RESERVE_PERIODIC };
+    if (check_reserve_attr(&attr) || !timespec_valid(&c_max) ||
+        timespec_compare(&c_min, &c_max) > 0 || timespec_compare(&c_max, &t) > 0) {
+        return -EINVAL;
+    }
+
+    // retrieve the task struct
+    if (pid == 0) {
+        task = current;
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if (!task) {
+            rcu_read_unlock();
+            return -ESRCH;
+        }
+        get_task_struct(task);
+        rcu_read_unlock();
+    }
+
+    // Never split, the controller resizes the budget of a task on a single cpu
+    mutex_lock(&bin_packing_mutex);
+    ret = __do_set_reserve(task, &attr, cpuid, false);
+    if (ret == 0) {
+        res_data = task->reservation_data;
+        res_data->adapt_C_min = c_min;
+        res_data->adapt_C_max = c_max;
+        spin_lock_irqsave(&res_data->exec.lock, flags);
+        memset(&res_data->adapt_hist, 0, sizeof(res_data->adapt_hist));
+        res_data->adapt_throttled = 0;
+        spin_unlock_irqrestore(&res_data->exec.lock, flags);
+        res_data->adaptive = true;
+        adapt_kick(res_data->reserve_cpu);
+    }
+    mutex_unlock(&bin_packing_mutex);
+
+    if (pid != 0)
+        put_task_struct(task);
+    return ret;
+}
+
+/**
+ * Profile mode
+ *  profile_reserve(pid, T, cpuid) lets the thread run unthrottled with period T for
+ *  /sys/rtes/config/profile_periods periods while its execution time per period is recorded. The budget
+ *  proposed afterwards is the /sys/rtes/config/profile_percentile percentile of the samples plus
+ *  /sys/rtes/config/profile_margin percent, readable in /sys/rtes/tasks/<pid>/profile. If
+ *  /sys/rtes/config/profile_apply is 1 the budget is applied through the normal admission path,
+ *  otherwise the thread keeps running unthrottled until set_reserve or cancel_reserve is called.
+ *
+ *  A profiling thread is not part of any processor bucket, so it does not count against admission.
+ */
+unsigned int profile_periods = 50;
+unsigned int profile_percentile = 95;
+unsigned int profile_margin = 10;
+unsigned int profile_apply = 0;
+
+// Runs in process context once the profiled thread has completed its periods
+void profile_work_fn(struct work_struct *work)
+{
+    struct reservation_data *res_data = container_of(work, struct reservation_data, profile_work);
+    struct task_struct *task = res_data->task;
+    struct reserve_attr attr;
+    u64 budget_us;
+    unsigned long flags;
+    long ret;
+
+    if (!res_data->has_reservation || !res_data->profiling)
+        return;
+
+    // Budget = percentile + margin, never more than the period
+    spin_lock_irqsave(&res_data->exec.lock, flags);
+    budget_us = hist_percentile(&res_data->exec.hist, profile_percentile * 10);
+    spin_unlock_irqrestore(&res_data->exec.lock, flags);
+    budget_us = div_u64(budget_us * (100 + profile_margin), 100);
+    if (budget_us * 1000 > timespec_to_ns(&res_data->reserve_T))
+        budget_us = div_u64(timespec_to_ns(&res_data->reserve_T), 1000);
+
+    // Nothing measured or jobs under 1 us: a budget of 0 would throttle the thread forever, keep profiling
+    if (budget_us == 0) {
+        res_data->profile_periods_left = profile_periods;
+        printk(KERN_INFO "profile: PID %d ran less than 1 us per period, profiling %u more periods\n",
+               task->pid, profile_periods);
+        return;
+    }
+
+    res_data->recommended_C = ns_to_timespec(budget_us * 1000);
+    res_data->profile_done = true;
+    printk(KERN_INFO "profile: PID %d recommended budget %llu us for period %ld.%09ld\n",
+           task->pid, budget_us, res_data->reserve_T.tv_sec, res_data->reserve_T.tv_nsec);
+
+    if (!profile_apply)
+        return;
+
+    get_task_struct(task);
+    attr = (struct reserve_attr){ .C = res_data->recommended_C, .T = res_data->reserve_T,
+                                  .D = res_data->reserve_T, .type = RESERVE_PERIODIC };
+    ret = check_reserve_attr(&attr);
+    if (!ret)
+        ret = do_set_reserve(task, &attr, res_data->profile_cpuid);
+    if (ret)
+        printk(KERN_ERR "profile: Failed to apply budget for PID %d with error %ld\n", task->pid, ret);
+    put_task_struct(task);
+}
+
+SYSCALL_DEFINE3(profile_reserve, pid_t, pid, struct timespec __user *, T, int, cpuid) {
+    struct task_struct *task;
+    struct reservation_data *res_data;
+    struct timespec t;
+    cpumask_t cpumask;
+    int ret = 0;
+
+    // ensure cpuid is valid
+    if (cpuid < -1 || (cpuid >= 0 && !rtes_cpu_valid(cpuid))) {
+        return -EINVAL;
+    }
+
+    if (copy_from_user(&t, T, sizeof(struct timespec))) {
+        return -EFAULT;
+    }
+
+    if (t.tv_sec < 0 || t.tv_nsec < 0 || timespec_to_ns(&t) == 0) {
+        return -EINVAL;
+    }
+
+    // retrieve the task struct
+    if (pid == 0) {
+        task = current;
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if (!task) {
+            rcu_read_unlock();
+            return -ESRCH;
+        }
+        get_task_struct(task);
+        rcu_read_unlock();
+    }
+
+    res_data = task->reservation_data;
+    if (res_data && res_data->has_reservation) {
+        ret = -EBUSY; // cancel the existing reservation first
+        goto out;
+    }
+
+    if (!res_data) {
+        res_data = create_reservation_data(task);
+        if (!res_data) {
+            ret = -ENOMEM;
+            goto out;
+        }
+    }
+
+    // Unthrottled: the budget is never checked while profiling
+    res_data->reserve_C = t;
+    res_data->reserve_T = t;
+    res_data->reserve_D = t;
+    res_data->task = task;
+    res_data->profiling = true;
+    res_data->profile_done = false;
+    res_data->profile_periods_left = profile_periods;
+    res_data->profile_cpuid = cpuid;
+    res_data->recommended_C = (struct timespec){0, 0};
+    res_data->monitoring_enabled = taskmon_enabled;
+    res_data->has_reservation = true;
+
+    reset_job_stats(res_data);
+    reset_exec_stats(res_data);
+    ret = create_task_dir(task);
+    if (ret) {
+        res_data->has_reservation = false;
+        res_data->profiling = false;
+        goto out;
+    }
+
+    if (cpuid >= 0) {
+        cpumask_clear(&cpumask);
+        cpumask_set_cpu(cpuid, &cpumask);
+        ret = set_cpus_allowed_ptr(task, &cpumask);
+        if (ret) {
+            printk(KERN_ERR "profile: Failed to set CPU affinity for PID %d\n", task->pid);
+            remove_task_dir(task);
+            res_data->has_reservation = false;
+            res_data->profiling = false;
+            goto out;
+        }
+    }
+
+    res_data->exec_accumulated_time = 0;
+    getrawmonotonic(&(res_data->exec_start_time));
+
+    hrtimer_init(&res_data->reservation_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    res_data->reservation_timer.function = reservation_timer_callback;
+    hrtimer_start(&res_data->reservation_timer, ktime_set(0, timespec_to_ns(&t)), HRTIMER_MODE_REL);
+
+    printk(KERN_INFO "profile_reserve called: pid=%d, T=%ld.%09ld, periods=%u, cpuid=%d\n",
+           task->pid, t.tv_sec, t.tv_nsec, profile_periods, cpuid);
+out:
+    if (pid != 0)
+        put_task_struct(task);
+    return ret;
+}
+
+
+//remove the thread
+SYSCALL_DEFINE1(cancel_reserve, pid_t, pid) {
+    struct task_struct *task;
+    struct reservation_data *res_data;
+    bool profiling;
+    int cpu;
+    // retrieve the task
+    if (pid == 0) {
+        task = current;
+    } else {
+        rcu_read_lock();
+        task = find_task_by_vpid(pid);
+        if (!task) {
+            rcu_read_unlock();
+            return -ESRCH;
         }
         get_task_struct(task);
         rcu_read_unlock();
@@ -791,6 +2240,21 @@ SYSCALL_DEFINE1(cancel_reserve, pid_t, pid) {
         return -EINVAL;
     }
 
+    // A member of a group leaves it, the group keeps its budget
+    if (res_data->group) {
+        mutex_lock(&group_mutex);
+        cpu = res_data->reserve_cpu;
+        if (res_data->group)
+            cancel_group_member(task, false);
+        mutex_unlock(&group_mutex);
+        printk(KERN_INFO "cancel_reserve: PID %d left its group\n", task->pid);
+        rtes_event(RTES_EVENT_CANCEL, task, cpu, 0);
+        if (pid != 0)
+            put_task_struct(task);
+        assign_rm_priorities(cpu);
+        return 0;
+    }
+
     // cancel hrtimer
     if (hrtimer_active(&res_data->reservation_timer)) {
         int ret = hrtimer_cancel(&res_data->reservation_timer);
@@ -798,6 +2262,17 @@ SYSCALL_DEFINE1(cancel_reserve, pid_t, pid) {
             printk(KERN_WARNING "cancel_reserve: Failed to cancel hrtimer for PID %d\n", task->pid);
         }
     }
+    cancel_work_sync(&res_data->profile_work);
+    cbs_stop(res_data);
+    split_stop(res_data);
+    reclaim_stop(res_data);
+    overrun_stop(res_data);
+    res_data->edf = false;
+    restore_task_sched(task);
+    cpu = res_data->reserve_cpu;
+    profiling = res_data->profiling;
+    res_data->profiling = false;
+    res_data->adaptive = false;
 
     // clear up reservation parameters
     res_data->reserve_C = (struct timespec){0, 0};
@@ -806,17 +2281,25 @@ SYSCALL_DEFINE1(cancel_reserve, pid_t, pid) {
     set_cpus_allowed_ptr(task, cpu_all_mask);
     res_data->has_reservation = false;
     remove_tid_file(task);
+    remove_task_dir(task);
     cleanup_utilization_data(task);
-    
-    if (pid != 0) 
-        put_task_struct(task);
 
-    // Remove task from the processor
-    remove_task_from_processor(task);
-    // Remove task from the reserved tasks list
-    remove_task_from_list(task);
+    // A profiling task was never admitted, so it is in no bucket
+    if (!profiling) {
+        // Remove task from the processor, global reservations are in no bucket
+        if (cpu != RTES_GLOBAL_CPU)
+            remove_task_from_processor(task);
+        // Remove task from the reserved tasks list
+        remove_task_from_list(task);
+        res_data->split.parts = 0;
+        // Close the gap left in the priorities of the cpu
+        assign_rm_priorities(cpu);
+    }
 
     printk(KERN_INFO "cancel_reserve: Reservation cancelled for PID %d\n", task->pid);
+    rtes_event(RTES_EVENT_CANCEL, task, cpu, 0);
+    if (pid != 0)
+        put_task_struct(task);
     return 0;
 }
 
@@ -837,8 +2320,17 @@ SYSCALL_DEFINE0(end_job) {
 
     printk(KERN_INFO "end_job: Suspended PID %d\n", current->pid);
 
+    // Current job is done, offer its unused budget and record its response time
+    if (current->reservation_data) {
+        reclaim_donate(current->reservation_data);
+        job_complete(current->reservation_data);
+    }
+
     // Set task state to TASK_UNINTERRUPTIBLE
     set_current_state(TASK_UNINTERRUPTIBLE);
+    // A member is released by the timer of its group, see group.c
+    if (current->reservation_data && current->reservation_data->group)
+        current->reservation_data->group_suspended = true;
     // Force a reschedule to suspend the current task
     schedule();
 
@@ -856,22 +2348,26 @@ static ssize_t reserves_show(struct kobject *kobj, struct kobj_attribute *attr,
      *   TID PID PRIO CPU NAME
      *   101 101 99 2 adb
      *   1568 1568 0 0 periodic
+     *   with the relative deadline D in us before the name
+     *   Cut at one page, /proc/rtes/reserves has every reservation and more columns (see procfs.c).
      */
     // Print values from the reserved_tasks_list in the required format
-    struct task_node *node;
+    struct reserved_task *node;
     struct task_struct *task;
     int len = 0;
 
     // Table header
-    len += sprintf(buf + len, " TID  PID PRIO CPU NAME\n");
+    len += scnprintf(buf + len, PAGE_SIZE - len, " TID  PID PRIO CPU       D_US NAME\n");
 
-    spin_lock(&reserved_tasks_list_lock); // Acquire the lock
-    list_for_each_entry(node, &reserved_tasks_list, list) {
+    rcu_read_lock();
+    list_for_each_entry_rcu(node, &reserved_tasks_list, list) {
         task = node->task;
-        // TID PID PRIO CPU NAME
-        len += sprintf(buf + len, "%4d %4d %4d %3d %s\n", task->pid, task->tgid, task->rt_priority, task_cpu(task), task->comm);
+        // TID PID PRIO CPU D_US NAME
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%4d %4d %4d %3d %10llu %s\n", task->pid, task->tgid,
+                         task->rt_priority, task_cpu(task),
+                         div_u64(timespec_to_ns(&task->reservation_data->reserve_D), 1000), task->comm);
     }
-    spin_unlock(&reserved_tasks_list_lock); // Release the lock
+    rcu_read_unlock();
 
     return len;
 }
@@ -935,6 +2431,57 @@ static ssize_t partition_policy_store(struct kobject *kobj, struct kobj_attribut
 }
 
 
+static ssize_t sched_policy_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    ssize_t len;
+    spin_lock(&policy_lock);
+    len = sprintf(buf, "%s\n", sched_policy_names[current_sched_policy]);
+    spin_unlock(&policy_lock);
+    return len;
+}
+
+static ssize_t sched_policy_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    enum reserve_sched_policy new_policy;
+    char input[16];
+    int i;
+
+    if (count > sizeof(input) - 1) {
+        return -EINVAL;
+    }
+    strncpy(input, buf, count);
+    input[count] = '\0';
+
+    for (i = 0; i < ARRAY_SIZE(sched_policy_names); i++) {
+        if (strncasecmp(input, sched_policy_names[i], strlen(sched_policy_names[i])) == 0) {
+            new_policy = i;
+            break;
+        }
+    }
+
+    if (i == ARRAY_SIZE(sched_policy_names)) {
+        printk(KERN_ERR "Invalid scheduling policy: %s\n", input);
+        return -EINVAL;
+    }
+
+    // The admission test and priorities of admitted tasks depend on the mode, groups are RM only even
+    // without members. An admission in progress holds bin_packing_mutex until its task is listed.
+    mutex_lock(&bin_packing_mutex);
+    if (has_reservations(false, NULL) || has_reservations(true, NULL)) {
+        mutex_unlock(&bin_packing_mutex);
+        printk(KERN_ERR "Cannot change scheduling policy: active reservations exist.\n");
+        return -EBUSY;
+    }
+
+    spin_lock(&policy_lock);
+    current_sched_policy = new_policy;
+    printk(KERN_INFO "Scheduling policy set to: %s\n", sched_policy_names[current_sched_policy]);
+    spin_unlock(&policy_lock);
+    mutex_unlock(&bin_packing_mutex);
+
+    return count;
+}
+
 /** Initializes the kobj_attribute struct with the reserves_show and partition_show & _store function
  *   - reserves, partition_policy is the name of the sysfs file
  *   - 0444 is the permissions of the sysfs file, read only for all users 0664 is read/write for owner and read only for group and others
@@ -944,6 +2491,7 @@ static ssize_t partition_policy_store(struct kobject *kobj, struct kobj_attribut
  */
 static struct kobj_attribute reserves_attr = __ATTR(reserves, 0444, reserves_show, NULL);
 static struct kobj_attribute partition_policy_attr = __ATTR(partition_policy, 0664, partition_policy_show, partition_policy_store);
+static struct kobj_attribute sched_policy_attr = __ATTR(sched_policy, 0664, sched_policy_show, sched_policy_store);
 
 
 // Create the sysfs file /sys/rtes/reserves
@@ -985,6 +2533,13 @@ static int create_partition_policy_file(void)
     }
 
     printk(KERN_INFO "partition_policy: Created file /sys/rtes/partition_policy\n");
+
+    // RM or EDF for the reserved tasks of each cpu, next to the partition policy
+    ret = sysfs_create_file(rtes_kobj, &sched_policy_attr.attr);
+    if (ret) {
+        printk(KERN_ERR "sched_policy: /sys/rtes/sched_policy creation failed\n");
+        return ret;
+    }
     return 0;
 }
 
@@ -999,8 +2554,14 @@ static int create_partition_policy_file(void)
  */
 static int __init init_reserve(void)
 {
-    int ret;
+    int ret, cpu;
     initialize_processors();
+
+    for_each_possible_cpu(cpu) {
+        INIT_DELAYED_WORK(&per_cpu(adapt_controllers, cpu).work, adapt_controller_fn);
+        per_cpu(adapt_controllers, cpu).cpu = cpu;
+    }
+
     ret = create_reserves_file();
     if (ret != 0) {
         printk(KERN_ERR "Failed to create reserves file\n");
@@ -1031,8 +2592,92 @@ static int __init partition_policy_init(void)
     return 0;
 }
 
+/**
+ * Tunables under /sys/rtes/config
+ *   profile_periods, profile_percentile, profile_margin, profile_apply   :   profile mode
+ *   adapt_interval_ms, adapt_percentile, adapt_headroom                  :   adaptive reservations
+ *   assign_priorities                                                    :   RM priority assignment
+ *   semi_partitioned                                                     :   task splitting, see split.c
+ *   reclaiming                                                           :   bandwidth reclaiming, see reclaim.c
+ *   event_interval_ms                                                    :   reservation events, see events.c
+ *   overhead_aware                                                       :   kernel overheads in C, see overhead.c
+ */
+struct config_param {
+    struct kobj_attribute attr;
+    unsigned int *value;
+    unsigned int min;
+    unsigned int max;
+};
+
+static ssize_t config_param_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    struct config_param *param = container_of(attr, struct config_param, attr);
+
+    return sprintf(buf, "%u\n", *param->value);
+}
+
+static ssize_t config_param_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count)
+{
+    struct config_param *param = container_of(attr, struct config_param, attr);
+    unsigned int value;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+
+    if (value < param->min || value > param->max)
+        return -EINVAL;
+
+    *param->value = value;
+    return count;
+}
+
+#define CONFIG_PARAM(_name, _min, _max) {                                           \
+    .attr = __ATTR(_name, 0664, config_param_show, config_param_store),             \
+    .value = &_name,                                                                \
+    .min = _min,                                                                    \
+    .max = _max,                                                                    \
+}
+
+static struct config_param config_params[] = {
+    CONFIG_PARAM(profile_periods, 1, 100000),
+    CONFIG_PARAM(profile_percentile, 1, 100),
+    CONFIG_PARAM(profile_margin, 0, 1000),
+    CONFIG_PARAM(profile_apply, 0, 1),
+    CONFIG_PARAM(adapt_interval_ms, 10, 60000),
+    CONFIG_PARAM(adapt_percentile, 1, 100),
+    CONFIG_PARAM(adapt_headroom, 0, 1000),
+    CONFIG_PARAM(assign_priorities, 0, 1),
+    CONFIG_PARAM(semi_partitioned, 0, 1),
+    CONFIG_PARAM(reclaiming, 0, 1),
+    CONFIG_PARAM(event_interval_ms, 10, 10000),
+    CONFIG_PARAM(overhead_aware, 0, 1),
+};
+
+static int __init config_params_init(void)
+{
+    int i, ret;
+
+    if (!config_kobj) {
+        printk(KERN_ERR "reserve: /sys/rtes/config is not initialized yet!\n");
+        return -EINVAL;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(config_params); i++) {
+        ret = sysfs_create_file(config_kobj, &config_params[i].attr.attr);
+        if (ret) {
+            printk(KERN_ERR "reserve: /sys/rtes/config/%s creation failed\n", config_params[i].attr.attr.name);
+            return ret;
+        }
+    }
+    return 0;
+}
+
 // Use postcore so that it runs after rtes_kobj is initialized by taskmon
 postcore_initcall(init_reserve);
 postcore_initcall(partition_policy_init);
+// Use subsys so that it runs after config_kobj is initialized by energy
+subsys_initcall(config_params_init);
 
 
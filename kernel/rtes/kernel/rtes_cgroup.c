@@ -0,0 +1,201 @@
+/**
+ * rtes cgroup controller
+ *  Gives every task of a cgroup a share of one group reservation (see group.c), so a whole application can
+ *  be covered without calling join_reserve_group for each of its threads:
+ *   - rtes.reserve: write "C_us T_us cpu" to admit a group budget for the cgroup, cpu -1 to let the
+ *     partition policy choose the cpu, or "0" to give the budget back. Reads back "C_us T_us cpu",
+ *     "0 0 -1" without a budget.
+ *   - rtes.stat: group id, members, periods and the budget used in the current period
+ *
+ *  Tasks in the cgroup when the budget is written, tasks attached later and their children all become
+ *  members, tasks moved out leave the group. A task with a reservation of its own keeps it. Changing the
+ *  budget admits the new one before the old one is given back, so it fails with -EBUSY if both do not fit.
+ *  The root cgroup cannot have a budget.
+ *
+ *  Budgets are written and tasks attached under cgroup_mutex, the group itself is created before it is
+ *  taken since bringing its cpu online takes cgroup_mutex in the cpuset hotplug handler. A forked child
+ *  joins from the post_fork callback, once it is on the task list.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/cgroup.h>
+#include <linux/seq_file.h>
+#include <linux/reservation.h>
+
+struct rtes_cgroup {
+    struct cgroup_subsys_state css;
+    int group_id;                       // group reservation of the tasks, 0 if none
+};
+
+static inline struct rtes_cgroup *cgroup_rtes(struct cgroup *cgrp)
+{
+    return container_of(cgroup_subsys_state(cgrp, rtes_subsys_id), struct rtes_cgroup, css);
+}
+
+static inline struct rtes_cgroup *task_rtes(struct task_struct *task)
+{
+    return container_of(task_subsys_state(task, rtes_subsys_id), struct rtes_cgroup, css);
+}
+
+// Make task a member of the group of the cgroup, called for every task it gets
+static void rtes_cgroup_join(struct task_struct *task, int group_id)
+{
+    long ret;
+
+    if (!group_id || (task->flags & PF_EXITING))
+        return;
+
+    ret = do_join_reserve_group(task, group_id, true);
+    if (ret)
+        printk(KERN_INFO "rtes cgroup: pid %d not added to group %d (%ld)\n", task->pid, group_id, ret);
+}
+
+static void rtes_cgroup_join_scanned(struct task_struct *task, struct cgroup_scanner *scan)
+{
+    rtes_cgroup_join(task, cgroup_rtes(scan->cg)->group_id);
+}
+
+static struct cgroup_subsys_state *rtes_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cgrp)
+{
+    struct rtes_cgroup *rc;
+
+    rc = kzalloc(sizeof(*rc), GFP_KERNEL);
+    if (!rc)
+        return ERR_PTR(-ENOMEM);
+    return &rc->css;
+}
+
+// The cgroup has no tasks left, its bandwidth is given back
+static void rtes_cgroup_destroy(struct cgroup_subsys *ss, struct cgroup *cgrp)
+{
+    struct rtes_cgroup *rc = cgroup_rtes(cgrp);
+
+    if (rc->group_id)
+        do_destroy_reserve_group(rc->group_id, true);
+    kfree(rc);
+}
+
+// Called for each task moved into cgrp, with cgroup_mutex held
+static void rtes_cgroup_attach_task(struct cgroup *cgrp, struct task_struct *task)
+{
+    do_leave_reserve_group(task, true);
+    rtes_cgroup_join(task, cgroup_rtes(cgrp)->group_id);
+}
+
+/**
+ * The child is in the cgroup of its parent, but not in its group since reservations are not inherited
+ * Joined once the fork succeeded and the child can be found by pid, so a failed fork never joins and
+ * an exiting member leaves its group in do_exit. If the child is moved meanwhile, whichever join comes
+ * second fails with -EBUSY.
+ */
+static void rtes_cgroup_post_fork(struct cgroup_subsys *ss, struct task_struct *task)
+{
+    int group_id;
+
+    rcu_read_lock();
+    group_id = ACCESS_ONCE(task_rtes(task)->group_id);
+    rcu_read_unlock();
+    rtes_cgroup_join(task, group_id);
+}
+
+static int rtes_reserve_show(struct cgroup *cgrp, struct cftype *cft, struct seq_file *m)
+{
+    struct reserve_group info;
+
+    if (!cgroup_rtes(cgrp)->group_id || reserve_group_info(cgroup_rtes(cgrp)->group_id, &info)) {
+        seq_printf(m, "0 0 -1\n");
+        return 0;
+    }
+    seq_printf(m, "%llu %llu %d\n", timespec_to_ns(&info.C) / NSEC_PER_USEC,
+               timespec_to_ns(&info.T) / NSEC_PER_USEC, info.cpu);
+    return 0;
+}
+
+static int rtes_reserve_write(struct cgroup *cgrp, struct cftype *cft, const char *buf)
+{
+    struct rtes_cgroup *rc = cgroup_rtes(cgrp);
+    struct cgroup_scanner scan;
+    unsigned long c_us, t_us;
+    long group_id = 0;
+    int cpu = -1, old_id, n;
+
+    if (!cgrp->parent)
+        return -EINVAL;
+
+    n = sscanf(buf, "%lu %lu %d", &c_us, &t_us, &cpu);
+    if (n == 1 && c_us == 0) {
+        t_us = 0;
+    } else if (n != 3 || c_us == 0) {
+        return -EINVAL;
+    } else {
+        group_id = do_create_reserve_group(ns_to_timespec((u64)c_us * NSEC_PER_USEC),
+                                           ns_to_timespec((u64)t_us * NSEC_PER_USEC), cpu, true);
+        if (group_id < 0)
+            return group_id;
+    }
+
+    if (!cgroup_lock_live_group(cgrp)) {
+        if (group_id)
+            do_destroy_reserve_group(group_id, true);
+        return -ENODEV;
+    }
+
+    old_id = rc->group_id;
+    rc->group_id = group_id;
+    if (old_id)
+        do_destroy_reserve_group(old_id, true);
+
+    if (group_id) {
+        memset(&scan, 0, sizeof(scan));
+        scan.cg = cgrp;
+        scan.process_task = rtes_cgroup_join_scanned;
+        cgroup_scan_tasks(&scan);
+    }
+    cgroup_unlock();
+    return 0;
+}
+
+static int rtes_stat_show(struct cgroup *cgrp, struct cftype *cft, struct seq_file *m)
+{
+    struct reserve_group info;
+
+    if (!cgroup_rtes(cgrp)->group_id || reserve_group_info(cgroup_rtes(cgrp)->group_id, &info)) {
+        seq_printf(m, "group 0\n");
+        return 0;
+    }
+    seq_printf(m, "group %d\n", info.id);
+    seq_printf(m, "members %d\n", info.nr_members);
+    seq_printf(m, "periods %llu\n", info.period_count);
+    seq_printf(m, "used_us %llu\n", (u64)atomic64_read(&info.exec_ns) / NSEC_PER_USEC);
+    seq_printf(m, "throttled %d\n", info.throttled);
+    return 0;
+}
+
+static struct cftype rtes_cgroup_files[] = {
+    {
+        .name = "reserve",
+        .read_seq_string = rtes_reserve_show,
+        .write_string = rtes_reserve_write,
+    },
+    {
+        .name = "stat",
+        .read_seq_string = rtes_stat_show,
+    },
+};
+
+static int rtes_cgroup_populate(struct cgroup_subsys *ss, struct cgroup *cgrp)
+{
+    return cgroup_add_files(cgrp, ss, rtes_cgroup_files, ARRAY_SIZE(rtes_cgroup_files));
+}
+
+struct cgroup_subsys rtes_subsys = {
+    .name = "rtes",
+    .create = rtes_cgroup_create,
+    .destroy = rtes_cgroup_destroy,
+    .populate = rtes_cgroup_populate,
+    .subsys_id = rtes_subsys_id,
+    .attach_task = rtes_cgroup_attach_task,
+    .post_fork = rtes_cgroup_post_fork,
+};
@@ -0,0 +1,158 @@
+/**
+ * RT thread change notifications
+ *  rt_thread_watch(flags) returns a file descriptor that becomes readable whenever a thread enters or
+ *  leaves the rt class or changes its rt priority. read() returns whole struct rt_thread_event records,
+ *  poll() and select() wait for them, flags takes O_NONBLOCK and O_CLOEXEC.
+ *
+ *  The changes are recorded by rt_threads_account (ps.c) into a ring of RT_WATCH_EVENTS records that
+ *  every open file reads from its own position. A reader that falls more than the ring behind gets one
+ *  record with tid 0 and has to list the threads again. Nothing is recorded while no file is open.
+ *
+ *  The records are written with the rq lock or the tasklist_lock held, where the readers cannot be woken,
+ *  so they are woken from an irq_work.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/irq_work.h>
+#include <linux/anon_inodes.h>
+#include <linux/syscalls.h>
+#include <linux/uaccess.h>
+#include <linux/reservation.h>
+
+// Records kept for the readers, a power of 2
+#define RT_WATCH_EVENTS 256
+// Records copied to userspace at a time
+#define RT_WATCH_BATCH 32
+
+static struct rt_thread_event rt_watch_ring[RT_WATCH_EVENTS];
+static u32 rt_watch_head;                      // sequence number of the next record
+static DEFINE_RAW_SPINLOCK(rt_watch_lock);
+static DECLARE_WAIT_QUEUE_HEAD(rt_watch_wait);
+static atomic_t rt_watchers = ATOMIC_INIT(0);
+static struct irq_work rt_watch_work;
+
+static void rt_watch_wake(struct irq_work *work)
+{
+    wake_up_interruptible(&rt_watch_wait);
+}
+
+// Record that task moved from rt priority old_prio to new_prio, called with irqs off
+void rt_watch_record(struct task_struct *task, unsigned int old_prio, unsigned int new_prio)
+{
+    struct rt_thread_event *ev;
+
+    if (!atomic_read(&rt_watchers))
+        return;
+
+    raw_spin_lock(&rt_watch_lock);
+    ev = &rt_watch_ring[rt_watch_head & (RT_WATCH_EVENTS - 1)];
+    ev->tid = task->pid;
+    ev->old_prio = old_prio;
+    ev->new_prio = new_prio;
+    ev->seq = rt_watch_head++;
+    raw_spin_unlock(&rt_watch_lock);
+
+    irq_work_queue(&rt_watch_work);
+}
+
+static bool rt_watch_pending(u32 *seq)
+{
+    return ACCESS_ONCE(rt_watch_head) != *seq;
+}
+
+static ssize_t rt_watch_read(struct file *filp, char __user *buf, size_t count, loff_t *f_pos)
+{
+    struct rt_thread_event batch[RT_WATCH_BATCH];
+    u32 *seq = filp->private_data;
+    unsigned long flags;
+    size_t n = 0, max = min_t(size_t, count / sizeof(batch[0]), RT_WATCH_BATCH);
+    int ret;
+
+    if (max == 0)
+        return -EINVAL;
+
+    if (!rt_watch_pending(seq)) {
+        if (filp->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        ret = wait_event_interruptible(rt_watch_wait, rt_watch_pending(seq));
+        if (ret)
+            return ret;
+    }
+
+    raw_spin_lock_irqsave(&rt_watch_lock, flags);
+    if (rt_watch_head - *seq > RT_WATCH_EVENTS) {
+        // Overwritten before they were read
+        memset(&batch[0], 0, sizeof(batch[0]));
+        batch[0].seq = *seq;
+        n = 1;
+        *seq = rt_watch_head;
+    }
+    for (; n < max && *seq != rt_watch_head; n++, (*seq)++)
+        batch[n] = rt_watch_ring[*seq & (RT_WATCH_EVENTS - 1)];
+    raw_spin_unlock_irqrestore(&rt_watch_lock, flags);
+
+    if (copy_to_user(buf, batch, n * sizeof(batch[0])))
+        return -EFAULT;
+    return n * sizeof(batch[0]);
+}
+
+static unsigned int rt_watch_poll(struct file *filp, poll_table *wait)
+{
+    poll_wait(filp, &rt_watch_wait, wait);
+    return rt_watch_pending(filp->private_data) ? POLLIN | POLLRDNORM : 0;
+}
+
+static int rt_watch_release(struct inode *inode, struct file *filp)
+{
+    atomic_dec(&rt_watchers);
+    kfree(filp->private_data);
+    return 0;
+}
+
+static const struct file_operations rt_watch_fops = {
+    .read = rt_watch_read,
+    .poll = rt_watch_poll,
+    .release = rt_watch_release,
+    .llseek = noop_llseek,
+};
+
+SYSCALL_DEFINE1(rt_thread_watch, int, flags) {
+    unsigned long irqflags;
+    u32 *seq;
+    int fd;
+
+    if (flags & ~(O_NONBLOCK | O_CLOEXEC))
+        return -EINVAL;
+
+    seq = kmalloc(sizeof(*seq), GFP_KERNEL);
+    if (!seq)
+        return -ENOMEM;
+
+    // Only changes from now on
+    atomic_inc(&rt_watchers);
+    raw_spin_lock_irqsave(&rt_watch_lock, irqflags);
+    *seq = rt_watch_head;
+    raw_spin_unlock_irqrestore(&rt_watch_lock, irqflags);
+
+    fd = anon_inode_getfd("[rt_thread_watch]", &rt_watch_fops, seq, O_RDONLY | flags);
+    if (fd < 0) {
+        atomic_dec(&rt_watchers);
+        kfree(seq);
+    }
+    return fd;
+}
+
+static int __init rt_watch_init(void)
+{
+    init_irq_work(&rt_watch_work, rt_watch_wake);
+    return 0;
+}
+
+core_initcall(rt_watch_init);
@@ -0,0 +1,173 @@
+/**
+ * Semi-partitioned reservations
+ *  With /sys/rtes/config/semi_partitioned = 1, a task that fits on no single cpu under the partition policy
+ *  is split instead of rejected: its deadline D is cut into n equal windows W = D / n and its budget into
+ *  portions C_1 + ... + C_n = C, portion k running on its own cpu within window k of every job.
+ *   - admission: portion k is checked on its cpu as a task (C_k, T, W) above the partitioned tasks, at most
+ *     one portion per cpu. n grows from 2 up to the number of cpus until the portions cover C, the cpu
+ *     that can take the largest portion going first.
+ *   - runtime: every job starts on the cpu of portion 1. When a portion's budget is used up the thread is
+ *     throttled, and at the start of the next window split_timer moves it to the cpu of the next portion
+ *     and releases it there. The replenishment timer brings it back to the first cpu at the next release.
+ *     A portion does not start on its cpu as soon as the previous one is used up: admission analyses it as
+ *     released at the start of its window, and an earlier release would interfere more than admitted.
+ *
+ * Only periodic reservations without offset are split, and only in RM mode.
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/cpumask.h>
+#include <linux/workqueue.h>
+#include <linux/math64.h>
+#include <linux/reservation.h>
+
+// Resolution of the portion search
+#define SPLIT_GRANULARITY_NS 10000
+
+unsigned int semi_partitioned = 0;
+
+
+// Largest budget up to max_ns that the cpu can take as a portion with window w
+static u64 max_portion(int cpu, u64 max_ns, struct timespec t, struct timespec w)
+{
+    u64 lo = 0, hi = max_ns, mid;
+
+    if (check_portion_schedulability(cpu, ns_to_timespec(hi), t, w) == 0)
+        return hi;
+
+    while (hi - lo > SPLIT_GRANULARITY_NS) {
+        mid = lo + (hi - lo) / 2;
+        if (check_portion_schedulability(cpu, ns_to_timespec(mid), t, w) == 0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Split the task (c, t, d) across cpus, called with bin_packing_mutex held
+ * Returns 0 and fills plan if the portions cover the whole budget, -EBUSY otherwise.
+ */
+int find_split(struct timespec c, struct timespec t, struct timespec d, struct split_plan *plan)
+{
+    cpumask_t used;
+    u64 remaining, window, portion, best;
+    int parts, k, cpu, best_cpu;
+
+    for (parts = 2; parts <= min_t(int, RTES_SPLIT_MAX_PARTS, num_possible_cpus()); parts++) {
+        window = div_u64(timespec_to_ns(&d), parts);
+        remaining = timespec_to_ns(&c);
+        cpumask_clear(&used);
+
+        for (k = 0; k < parts && remaining > 0; k++) {
+            best = 0;
+            best_cpu = -1;
+            for_each_possible_cpu(cpu) {
+                if (cpumask_test_cpu(cpu, &used))
+                    continue;
+                portion = max_portion(cpu, min(remaining, window), t, ns_to_timespec(window));
+                if (portion > best) {
+                    best = portion;
+                    best_cpu = cpu;
+                }
+            }
+            if (best_cpu < 0)
+                break;
+
+            cpumask_set_cpu(best_cpu, &used);
+            plan->cpu[k] = best_cpu;
+            plan->C[k] = ns_to_timespec(best);
+            remaining -= best;
+        }
+
+        if (remaining == 0) {
+            plan->parts = k;
+            plan->window_ns = window;
+            return 0;
+        }
+    }
+    return -EBUSY;
+}
+
+// Pin the thread to the cpu of its current portion
+static void split_migrate(struct reservation_data *res_data)
+{
+    if (rtes_move_sleeping_task(res_data->task, res_data->split.cpu[res_data->split_idx]))
+        schedule_work(&res_data->split_work);   // Queued or running, needs the migration thread
+}
+
+static void split_work_fn(struct work_struct *work)
+{
+    struct reservation_data *res_data = container_of(work, struct reservation_data, split_work);
+
+    if (!res_data->has_reservation || !res_data->split.parts)
+        return;
+
+    set_cpus_allowed_ptr(res_data->task, cpumask_of(res_data->split.cpu[res_data->split_idx]));
+}
+
+// Start of the next window: move to the next portion and release it
+static enum hrtimer_restart split_timer_callback(struct hrtimer *timer)
+{
+    struct reservation_data *res_data = container_of(timer, struct reservation_data, split_timer);
+    struct task_struct *task = res_data->task;
+
+    if (res_data->split_idx + 1 >= res_data->split.parts)
+        return HRTIMER_NORESTART;
+
+    res_data->split_idx++;
+    res_data->split_base_ns = res_data->exec_accumulated_time;
+    split_migrate(res_data);
+
+    // Throttled at the end of the previous portion, a thread done with its job waits for the release
+    if (res_data->jobs.job_active && task->state == TASK_UNINTERRUPTIBLE)
+        wake_up_process(task);
+
+    if (res_data->split_idx + 1 < res_data->split.parts) {
+        hrtimer_forward(timer, hrtimer_get_expires(timer), ns_to_ktime(res_data->split.window_ns));
+        return HRTIMER_RESTART;
+    }
+    return HRTIMER_NORESTART;
+}
+
+// Called once when the reservation data is created
+void split_init(struct reservation_data *res_data)
+{
+    hrtimer_init(&res_data->split_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    res_data->split_timer.function = split_timer_callback;
+    INIT_WORK(&res_data->split_work, split_work_fn);
+}
+
+// Arm the window boundaries of the job released at release_ns
+void split_start(struct reservation_data *res_data, u64 release_ns)
+{
+    if (res_data->split.parts > 1)
+        hrtimer_start(&res_data->split_timer, ns_to_ktime(release_ns + res_data->split.window_ns),
+                      HRTIMER_MODE_ABS);
+}
+
+// New job, called by the replenishment timer before it wakes the thread
+void split_release(struct reservation_data *res_data, u64 release_ns)
+{
+    res_data->split_idx = 0;
+    res_data->split_base_ns = 0;    // exec_accumulated_time was reset for the new period
+    split_migrate(res_data);
+    split_start(res_data, release_ns);
+}
+
+// Stop the window timer when the reservation is reset, cancelled or the thread exits
+void split_stop(struct reservation_data *res_data)
+{
+    hrtimer_cancel(&res_data->split_timer);
+    cancel_work_sync(&res_data->split_work);
+}
+
+// Limit of the accumulated execution time of the job in the current portion, see context_switch
+u64 split_budget_ns(struct reservation_data *res_data)
+{
+    return res_data->split_base_ns + timespec_to_ns(&res_data->split.C[res_data->split_idx]);
+}
@@ -0,0 +1,229 @@
+/**
+ * Streaming statistics for reservations
+ *  Histograms and running statistics that can be updated from the timer callback and the scheduler in
+ *  O(1) without allocating, and read back in O(1) regardless of how long the reservation has existed.
+ *
+ *  - rtes_hist: log-linear (HDR style) histogram of microsecond values with percentile queries
+ *  - exec_stats: Welford running mean/variance, min/max and histogram of the execution time per period
+ *
+ * The execution time summary is exported as /sys/rtes/tasks/<pid>/exec_stats
+ */
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/math64.h>
+#include <linux/bitops.h>
+#include <linux/reservation.h>
+
+
+// Bucket index of a microsecond value
+static int hist_index(u64 value_us)
+{
+    int shift, idx;
+
+    if (value_us < RTES_HIST_SUB)
+        return value_us;
+
+    shift = fls64(value_us) - 1 - RTES_HIST_SUB_BITS;
+    idx = (shift + 1) * RTES_HIST_SUB + ((value_us >> shift) & (RTES_HIST_SUB - 1));
+    return min(idx, RTES_HIST_BUCKETS - 1);
+}
+
+// Smallest microsecond value that falls in the bucket
+static u64 hist_bucket_lo(int idx)
+{
+    int shift;
+
+    if (idx < RTES_HIST_SUB)
+        return idx;
+
+    shift = idx / RTES_HIST_SUB - 1;
+    return (u64)(RTES_HIST_SUB + idx % RTES_HIST_SUB) << shift;
+}
+
+// Largest microsecond value that falls in the bucket
+static u64 hist_bucket_hi(int idx)
+{
+    if (idx < RTES_HIST_SUB)
+        return idx;
+
+    return hist_bucket_lo(idx) + (1ULL << (idx / RTES_HIST_SUB - 1)) - 1;
+}
+
+// Add a sample in nanoseconds to the histogram
+void hist_add(struct rtes_hist *hist, u64 value_ns)
+{
+    u64 value_us = div_u64(value_ns, 1000);
+
+    hist->buckets[hist_index(value_us)]++;
+    hist->count++;
+    hist->sum_us += value_us;
+    if (value_us > hist->max_us)
+        hist->max_us = value_us;
+}
+
+/**
+ * Value (us) below which permille/1000 of the samples fall
+ * Returns the upper bound of the bucket holding the percentile, so the estimate errs on the safe
+ * (pessimistic) side, but never reports more than the largest sample seen.
+ */
+u64 hist_percentile(struct rtes_hist *hist, unsigned int permille)
+{
+    u64 target, seen = 0;
+    int i;
+
+    if (!hist->count)
+        return 0;
+
+    target = div_u64(hist->count * permille + 999, 1000);
+    if (!target)
+        target = 1;
+
+    for (i = 0; i < RTES_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target)
+            return min(hist_bucket_hi(i), hist->max_us);
+    }
+    return hist->max_us;
+}
+
+// Print the histogram: summary followed by the non-empty buckets
+ssize_t hist_show(struct rtes_hist *hist, char *buf)
+{
+    ssize_t len = 0;
+    int i;
+
+    len += scnprintf(buf + len, PAGE_SIZE - len, "count %llu\n", hist->count);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "mean_us %llu\n",
+                     hist->count ? div64_u64(hist->sum_us, hist->count) : 0);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "max_us %llu\n", hist->max_us);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "p50_us %llu\n", hist_percentile(hist, 500));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "p99_us %llu\n", hist_percentile(hist, 990));
+
+    for (i = 0; i < RTES_HIST_BUCKETS; i++) {
+        if (!hist->buckets[i])
+            continue;
+        if (i == RTES_HIST_BUCKETS - 1)
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%llu+ %u\n",
+                             hist_bucket_lo(i), hist->buckets[i]);
+        else
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%llu-%llu %u\n",
+                             hist_bucket_lo(i), hist_bucket_hi(i), hist->buckets[i]);
+    }
+    return len;
+}
+
+// Integer square root of a 64-bit value
+static u64 isqrt64(u64 x)
+{
+    u64 root = 0, bit = 1ULL << 62;
+
+    while (bit > x)
+        bit >>= 2;
+
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// Clear the execution time statistics, called when a reservation is (re)set or a monitoring session starts
+void reset_exec_stats(struct reservation_data *res_data)
+{
+    struct exec_stats *es = &res_data->exec;
+    unsigned long flags;
+
+    spin_lock_irqsave(&es->lock, flags);
+    es->samples = 0;
+    es->mean_ns = 0;
+    es->m2_us = 0;
+    es->min_ns = 0;
+    es->max_ns = 0;
+    memset(&es->hist, 0, sizeof(es->hist));
+    spin_unlock_irqrestore(&es->lock, flags);
+}
+
+/**
+ * Add the execution time of one period, called from the reservation timer callback
+ * Welford's update: the mean is kept in ns, the squared deviations in us^2 so a sum
+ * of many samples of up to a minute each does not overflow.
+ * The summary is only kept while the task is monitored (taskmon) or profiled, the window
+ * of the adaptive controller always.
+ */
+void exec_stats_add(struct reservation_data *res_data, u64 exec_ns)
+{
+    struct exec_stats *es = &res_data->exec;
+    s64 delta, delta2;
+
+    if (!res_data->monitoring_enabled && !res_data->profiling && !res_data->adaptive)
+        return;
+
+    spin_lock(&es->lock);   // hrtimer callback, irqs are off
+    if (!res_data->monitoring_enabled && !res_data->profiling)
+        goto adapt;
+
+    es->samples++;
+    delta = (s64)exec_ns - es->mean_ns;
+    es->mean_ns += div64_s64(delta, es->samples);
+    delta2 = (s64)exec_ns - es->mean_ns;
+    es->m2_us += (u64)(div_s64(delta, 1000) * div_s64(delta2, 1000));
+
+    if (es->samples == 1 || exec_ns < es->min_ns)
+        es->min_ns = exec_ns;
+    if (exec_ns > es->max_ns)
+        es->max_ns = exec_ns;
+
+    hist_add(&es->hist, exec_ns);
+
+adapt:
+    // Window of the adaptive controller, emptied at each of its steps
+    if (res_data->adaptive) {
+        hist_add(&res_data->adapt_hist, exec_ns);
+        if (exec_ns >= timespec_to_ns(&res_data->reserve_C))
+            res_data->adapt_throttled++;
+    }
+    spin_unlock(&es->lock);
+}
+
+// Print the summary of the execution time per period
+ssize_t exec_stats_show(struct reservation_data *res_data, char *buf)
+{
+    struct exec_stats *es = &res_data->exec;
+    u64 period_ns = timespec_to_ns(&res_data->reserve_T);
+    u64 variance_us = 0, util = 0;
+    u32 util_frac;
+    unsigned long flags;
+    ssize_t len = 0;
+
+    spin_lock_irqsave(&es->lock, flags);
+    if (es->samples > 1)
+        variance_us = div64_u64(es->m2_us, es->samples - 1);
+    if (period_ns)
+        util = div64_u64((u64)es->mean_ns * 100, period_ns);
+    util = div_u64_rem(util, 100, &util_frac);
+
+    len += scnprintf(buf + len, PAGE_SIZE - len, "samples %llu\n", es->samples);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "mean_us %llu\n", div_u64(es->mean_ns, 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "stddev_us %llu\n", isqrt64(variance_us));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "min_us %llu\n", div_u64(es->min_ns, 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "max_us %llu\n", div_u64(es->max_ns, 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "p50_us %llu\n", hist_percentile(&es->hist, 500));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "p90_us %llu\n", hist_percentile(&es->hist, 900));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "p95_us %llu\n", hist_percentile(&es->hist, 950));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "p99_us %llu\n", hist_percentile(&es->hist, 990));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "util_mean %llu.%02u\n", util, util_frac);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "reclaimed_us %llu\n", div_u64(res_data->reclaimed_total_ns, 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "overruns %llu\n", res_data->overruns);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "cs_declared_us %llu\n", div_u64(res_data->block_declared_ns, 1000));
+    len += scnprintf(buf + len, PAGE_SIZE - len, "cs_measured_us %llu\n", div_u64(res_data->block_measured_ns, 1000));
+    spin_unlock_irqrestore(&es->lock, flags);
+
+    return len;
+}
@@ -23,7 +23,6 @@
 #include <linux/kobject.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
-#include <linux/mutex.h>
 #include <linux/list.h>
 #include <linux/sched.h>
 #include <linux/uaccess.h>
@@ -39,17 +38,6 @@ struct kobject *rtes_kobj;    // kobject for /rtes
 struct kobject *taskmon_kobj; // kobject for /rtes/taskmon
 struct kobject *util_kobj;    // kobject for /rtes/taskmon/util
 
-struct tid_attr_node
-{
-    struct kobj_attribute *attr;
-    struct tid_attr_node *next;
-};
-
-// Store the list of TID attributes
-static struct tid_attr_node *tid_attr_list = NULL;
-
-// Mutex to protect the tid_attr_list
-static DEFINE_MUTEX(tid_attr_list_mutex);
 
 // When the user reads the sysfs file
 static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
@@ -79,82 +67,35 @@ static ssize_t enabled_store(struct kobject *kobj, struct kobj_attribute *attr,
     return count;
 }
 
-// When the user reads the sysfs file
-static ssize_t tid_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+// Utilization data points of res_data as "<ms> <util>" lines, also /sys/rtes/tasks/<tid>/util
+ssize_t util_show(struct reservation_data *res_data, char *buf)
 {
-    // // Return the current value of taskmon_enabled as 0 or 1
-    // return sprintf(buf, "%s\n%s\n%s\n", "10 0.5", "14 0.25", "18 0.25");
-    struct task_struct *task;
-    struct reservation_data *res_data;
-    const char *file_name;
     struct data_point *point;
-    ssize_t len = 0;
-    ssize_t temp_len;
-    pid_t pid = -1;
     unsigned long flags;
-    int ret;
-
-    file_name = attr->attr.name; // file name
-    printk(KERN_INFO "tid_show: file_name: %s\n", file_name);
-    if ((ret = kstrtoint(file_name, 10, &pid)) != 0) {
-        printk(KERN_ERR "tid_show: Failed to read pid (%d) from kobject name\n", pid);
-        return ret;
-    }
-
-    // Find the task by PID
-    rcu_read_lock();
-    task = find_task_by_vpid(pid);
-    if (!task) {
-        printk(KERN_ERR "tid_show: find_task_by_vpid failed\n");
-        rcu_read_unlock();
-        return -ESRCH;
-    }
-    get_task_struct(task);
-    rcu_read_unlock();
-
-    printk(KERN_INFO "tid_show: PID = %d\n", pid);
-    
-    res_data = task->reservation_data;      // Get the reservation data
-    if (!res_data) {
-        put_task_struct(task);
-        return snprintf(buf, PAGE_SIZE, "No reservation data available\n");
-    }
+    ssize_t len = 0;
 
     spin_lock_irqsave(&res_data->data_lock, flags);
     if (list_empty(&res_data->data_points)) {
         spin_unlock_irqrestore(&res_data->data_lock, flags);
-        put_task_struct(task);
-
-        return snprintf(buf, PAGE_SIZE, "No utilization data available yet\n");
+        return scnprintf(buf, PAGE_SIZE, "No utilization data available yet\n");
     }
 
-    // Iterate through the utilization data points and format them correctly
-    list_for_each_entry(point, &res_data->data_points, list)
-    {
-        temp_len = snprintf(buf + len, PAGE_SIZE - len, "%llu %s\n",
-                            point->timestamp,
-                            point->utilization);
-        if (temp_len < 0) {
-            spin_unlock_irqrestore(&res_data->data_lock, flags);
-            put_task_struct(task);
-            return temp_len; // Return the error code if snprintf fails
-        }
-
-        len += temp_len;
-
-        if (len >= PAGE_SIZE) {
-            len = PAGE_SIZE; // Truncate output if we exceed the buffer size
+    // Iterate through the utilization data points, cut at one page
+    list_for_each_entry(point, &res_data->data_points, list) {
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%llu %s\n", point->timestamp, point->utilization);
+        if (len >= PAGE_SIZE - 1)
             break;
-        }
     }
-
     spin_unlock_irqrestore(&res_data->data_lock, flags);
-    put_task_struct(task);
-
-    printk(KERN_INFO "DEBUG: tid_show end, length: %zd\n", len);
     return len;
 }
 
+// When the user reads /sys/rtes/taskmon/util/<tid>, the attribute is the one of the reservation
+static ssize_t tid_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return util_show(container_of(attr, struct reservation_data, taskmon_tid_attr), buf);
+}
+
 /** Initializes the kobj_attribute struct with the enabled_show and enabled_store functions
  *   - enabled is the name of the sysfs file
  *   - 0660 is the permissions of the sysfs file, owner can read/write, group can read/write, others can't access
@@ -208,26 +149,6 @@ void release_kobjects(void)
     }
 }
     
-// free the tid_attr_list
-void free_tid_attr_list(void)
-{
-    struct tid_attr_node *node, *next;
-    mutex_lock(&tid_attr_list_mutex);
-    node = tid_attr_list;
-
-    while (node)
-    {
-        next = node->next;
-        // sysfs_remove_file(util_kobj, &node->attr->attr);
-        kfree(node->attr->attr.name);
-        kfree(node->attr);
-        kfree(node);
-        node = next;
-    }
-    tid_attr_list = NULL;
-    mutex_unlock(&tid_attr_list_mutex);
-}
-
 // Create the sysfs file /sys/rtes/taskmon/enabled
 int create_enabled_file(void)
 {
@@ -246,120 +167,47 @@ int create_enabled_file(void)
 }
 
 
-// Create the sysfs file /sys/rtes/taskmon/util/<tid>
-// create the kobj_attribute, create the sysfs file, add the attribute to the list, and link the attribute to the reservation data
+/**
+ * Create the sysfs file /sys/rtes/taskmon/util/<tid>
+ * The attribute and its name are part of the reservation data, so tid_show finds the data points from the
+ * attribute and nothing has to be looked up or kept in a list.
+ */
 int create_tid_file(struct task_struct *task)
 {
-    int ret;
-    struct kobj_attribute *tid_attr;
-    struct tid_attr_node *new_node;
     struct reservation_data *res_data = task->reservation_data;
-    char tid_str[10];
+    struct kobj_attribute *tid_attr = &res_data->taskmon_tid_attr;
+    int ret;
 
-    // Allocate memory for the attribute
-    tid_attr = kzalloc(sizeof(*tid_attr), GFP_KERNEL); // alloc and init to zero
-    if (!tid_attr)
-        return -ENOMEM;
-    // Initialize the attribute
-    snprintf(tid_str, sizeof(tid_str), "%d", task->pid);
-    // Initialize the attribute
-    tid_attr->attr.name = kstrdup(tid_str, GFP_KERNEL);
-    if (!tid_attr->attr.name) {
-        printk(KERN_ERR "create_tid_file: Failed to allocate memory for attr.name\n");
-        kfree(tid_attr);
-        return -ENOMEM;
-    }
+    if (tid_attr->attr.name)
+        return 0; // Already exists
+
+    snprintf(res_data->taskmon_tid_name, sizeof(res_data->taskmon_tid_name), "%d", task->pid);
+    sysfs_attr_init(&tid_attr->attr);
+    tid_attr->attr.name = res_data->taskmon_tid_name;
     tid_attr->attr.mode = 0444; // Read-only
     tid_attr->show = tid_show;
     tid_attr->store = NULL;
-    res_data->taskmon_tid_attr = tid_attr;
 
-    // Create the sysfs file
-    // ret = sysfs_create_file(res_data->taskmon_kobj, &tid_attr->attr);
     ret = sysfs_create_file(util_kobj, &tid_attr->attr);
-    if (ret)
-    {
+    if (ret) {
         printk(KERN_ERR "create_tid_file: Failed to create file: /sys/rtes/taskmon/util/%d\n", task->pid);
-        kfree(tid_attr->attr.name);
-        kfree(tid_attr);
+        tid_attr->attr.name = NULL;
         return ret;
     }
-
-    printk(KERN_INFO "create_tid_file: Created file: /sys/rtes/taskmon/util/%d\n", task->pid);
-
-    // Add attribute to the list
-    new_node = kzalloc(sizeof(*new_node), GFP_KERNEL);
-    if (!new_node)
-    {
-        printk(KERN_ERR "create_tid_file: Failed to allocate memory for new_node\n");
-        sysfs_remove_file(util_kobj, &tid_attr->attr);
-        kfree(tid_attr->attr.name);
-        kfree(tid_attr);
-        return -ENOMEM;
-    }
-    new_node->attr = tid_attr;
-    mutex_lock(&tid_attr_list_mutex);
-    new_node->next = tid_attr_list;
-    tid_attr_list = new_node;
-    mutex_unlock(&tid_attr_list_mutex);
-    printk(KERN_INFO "create_tid_file: Successfully created sysfs file /sys/rtes/taskmon/util/%d\n", task->pid);
     return 0; // Success
 }
 
-// remove /sys/rtes/taskmon/util/<tid>
-// list tracersal to find the matching node by tid, remove the sysfs file, free the memory, and clear the attribute pointer in reservation data
-int remove_tid_file(struct task_struct *task) {
+// Remove /sys/rtes/taskmon/util/<tid>
+int remove_tid_file(struct task_struct *task)
+{
     struct reservation_data *res_data = task->reservation_data;
-    struct tid_attr_node *node, *prev = NULL;
-    int ret = -ENOENT;
-
-    if (!res_data || !res_data->taskmon_tid_attr) {
-        printk(KERN_ERR "remove_tid_file: Invalid reservation data or taskmon_tid_attr for PID %d\n", task->pid);
-        return -EINVAL; // Task does not have an associated kobject.
-    }
-
-    mutex_lock(&tid_attr_list_mutex);
-
-    // Traverse the tid_attr_list to find the matching node
-    node = tid_attr_list;
-    while (node) {
-        if (node->attr == res_data->taskmon_tid_attr) {
-            // Remove the sysfs file
-            printk(KERN_INFO "remove_tid_file: Found tid_attr_node for PID %d\n", task->pid);
 
-            sysfs_remove_file(util_kobj, &node->attr->attr);
-            printk(KERN_INFO "remove_tid_file: Removed sysfs file for PID %d\n", task->pid);
+    if (!res_data || !res_data->taskmon_tid_attr.attr.name)
+        return -EINVAL; // Task does not have the file
 
-            // Remove node from the list
-            if (prev) {
-                prev->next = node->next;
-            } else {
-                tid_attr_list = node->next;
-            }
-
-            // Free allocated memory
-            kfree(node->attr->attr.name);
-            kfree(node->attr);
-            kfree(node);
-
-            // Clear the attribute pointer in reservation data
-            res_data->taskmon_tid_attr = NULL;
-
-            ret = 0; // Success
-            printk(KERN_INFO "remove_tid_file: Successfully removed sysfs file for PID %d\n", task->pid);
-            break;
-        }
-        prev = node;
-        node = node->next;
-    }
-
-    if (ret != 0) {
-        printk(KERN_ERR "remove_tid_file: No matching tid_attr_node found for PID %d\n", task->pid);
-    }
-
-    mutex_unlock(&tid_attr_list_mutex);
-
-    return ret;
+    sysfs_remove_file(util_kobj, &res_data->taskmon_tid_attr.attr);
+    res_data->taskmon_tid_attr.attr.name = NULL;
+    return 0;
 }
 
 
@@ -401,6 +249,7 @@ void enable_monitoring_for_all_tasks(void)
             task->reservation_data->monitoring_enabled = true;
             spin_lock_init(&task->reservation_data->data_lock);
             INIT_LIST_HEAD(&task->reservation_data->data_points);
+            reset_exec_stats(task->reservation_data);  // New session, new summary
             printk(KERN_INFO "Monitoring enabled for PID %d\n", task->pid);
         }
     }
@@ -428,7 +277,6 @@ void disable_monitoring_for_all_tasks(void)
 static int __init init_taskmon(void)
 {
     int ret;
-    free_tid_attr_list();
     release_kobjects();
 
     ret = init_kobjects();
@@ -4,5 +4,7 @@
 extern struct kobject *rtes_kobj;    // kobject for /rtes
 extern struct kobject *taskmon_kobj; // kobject for /rtes/taskmon
 extern struct kobject *util_kobj;    // kobject for /rtes/taskmon/util
+extern struct kobject *tasks_kobj;   // kobject for /rtes/tasks
+extern struct kobject *config_kobj;  // kobject for /rtes/config
 
 #endif // TASKMON_H
\ No newline at end of file
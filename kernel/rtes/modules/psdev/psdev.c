@@ -32,6 +32,10 @@
  *     g) rmmod psdev
  *     h) rm /dev/psdev[k]
  * 
+ * The output is produced by seq_file as it is read, from the rt thread index of the kernel
+ * (rt_thread_next in kernel/rtes/kernel/ps.c) walked under rcu_read_lock in tid order, so it has
+ * no size limit and needs no buffer beyond the seq_file page. Every open has its own cursor, and
+ * seq_read serializes concurrent reads on the same file descriptor.
  */ 
 #include <linux/init.h>
 #include <linux/module.h>
@@ -49,27 +53,32 @@
 #include <linux/rwlock.h>
 #include <asm/errno.h>
 #include <linux/rcupdate.h>
+#include <linux/seq_file.h>
+#include <linux/pid_namespace.h>
+#include <linux/reservation.h>
 
 MODULE_LICENSE("Dual BSD/GPL");
 
 #define DEVICE_NAME "psdev"     
 #define MAX_DEVICE_INSTANCES 5   /* Max number of minor device */
-#define MAX_BUFFER_SIZE 1024     /* Max buffer size for device */
 
 /* device informatino register */
 struct psdev_data {
     struct cdev cdev;       /* Character device structure*/
     struct mutex mutex;     /* Mutex for device */
     int is_open;            /* Device is open */ 
-    char *data;             /* Data buffer to store ouptup */ 
-    size_t data_size;       /* Size of output data */
+};
+
+/* cursor of one open, the entry at position pos is the first rt thread with a tid >= tid */
+struct psdev_iter {
+    struct pid_namespace *ns;
+    loff_t pos;
+    pid_t tid;
 };
 
 static int psdev_open(struct inode *inode, struct file *filp);
 static int psdev_release(struct inode *inode, struct file *filp);
-static ssize_t psdev_read(struct file *filp, char __user *buf, size_t count, loff_t *f_pos);
 static long psdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
-static void gather_rt_thread_info(struct psdev_data *dev);
 static ssize_t psdev_write(struct file *filp, const char __user *buf, size_t count, loff_t *f_pos) {
     return -ENOTSUPP; // Operation not supported
 }
@@ -80,7 +89,7 @@ static loff_t psdev_llseek(struct file *filp, loff_t off, int whence) {
 /* initialize file operations */
 static const struct file_operations psdev_fops = {
     .owner = THIS_MODULE,
-    .read = psdev_read,
+    .read = seq_read,
     .write = psdev_write,
     .llseek = psdev_llseek,
     .open = psdev_open,
@@ -93,10 +102,66 @@ static int psdev_major;     // stores major number
 static struct psdev_data mypsdev_data[MAX_DEVICE_INSTANCES];    // for each device instance
 
 
-// open device: lock, check if device is open, allocate memory, gather rt thread info, unlock
+// start of a read chunk: resume at the cursor, or walk the index again if the position is not the cursor's
+static void *psdev_seq_start(struct seq_file *m, loff_t *pos)
+{
+    struct psdev_iter *iter = m->private;
+    struct task_struct *t = NULL;
+    loff_t i;
+
+    rcu_read_lock();
+    if (*pos == 0)
+        return SEQ_START_TOKEN;
+
+    if (*pos != iter->pos) {
+        iter->tid = 1;
+        for (i = 1; i < *pos && rt_thread_next(iter->ns, &iter->tid); i++)
+            iter->tid++;
+        iter->pos = *pos;
+    }
+    t = rt_thread_next(iter->ns, &iter->tid);
+    return t;
+}
+
+static void *psdev_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+    struct psdev_iter *iter = m->private;
+
+    iter->tid = (v == SEQ_START_TOKEN) ? 1 : iter->tid + 1;
+    iter->pos = ++*pos;
+    return rt_thread_next(iter->ns, &iter->tid);
+}
+
+static void psdev_seq_stop(struct seq_file *m, void *v)
+{
+    rcu_read_unlock();
+}
+
+static int psdev_seq_show(struct seq_file *m, void *v)
+{
+    struct psdev_iter *iter = m->private;
+    struct task_struct *t = v;
+
+    if (v == SEQ_START_TOKEN) {
+        seq_printf(m, "%6s %6s %6s %8s\n", "tid", "pid", "pr", "name");
+        return 0;
+    }
+    seq_printf(m, "%6d  %6d   %4d   %s\n", iter->tid, task_tgid_nr_ns(t, iter->ns), t->rt_priority, t->comm);
+    return 0;
+}
+
+static const struct seq_operations psdev_seq_ops = {
+    .start = psdev_seq_start,
+    .next = psdev_seq_next,
+    .stop = psdev_seq_stop,
+    .show = psdev_seq_show,
+};
+
+// open device: lock, check if device is open, set up the cursor of this open, unlock
 static int psdev_open(struct inode *inode, struct file *filp) 
 {
     struct psdev_data *psdev;
+    struct psdev_iter *iter;
     psdev = container_of(inode->i_cdev, struct psdev_data, cdev);
     mutex_lock(&psdev->mutex);
 
@@ -105,55 +170,35 @@ static int psdev_open(struct inode *inode, struct file *filp)
         return -EBUSY;                  /* access limit is exceeded */    
     }
 
-    psdev->is_open = 1;
-    filp->private_data = psdev;
-
-    psdev->data = kmalloc(MAX_BUFFER_SIZE, GFP_KERNEL);
-    if(!psdev->data) {
-        psdev->is_open = 0;
+    iter = __seq_open_private(filp, &psdev_seq_ops, sizeof(*iter));
+    if (!iter) {
         mutex_unlock(&psdev->mutex);
         return -ENOMEM;                 /* memory allocation fail */
     }
-    
-    memset(psdev->data, 0, MAX_BUFFER_SIZE);
-    // print rt thread info here
-    gather_rt_thread_info(psdev);
+    // The fd can be passed on and outlive the namespace of the opener
+    iter->ns = get_pid_ns(task_active_pid_ns(current));
+    iter->pos = 0;
+
+    psdev->is_open = 1;
     mutex_unlock(&psdev->mutex);
-    try_module_get(THIS_MODULE);    // increase module reference count
     return 0;
 }
 
-// close device: lock, free memory, unset flag, unlock
+// close device: lock, free the cursor, unset flag, unlock
 static int psdev_release(struct inode *inode, struct file *filp) 
 {
-    struct psdev_data *psdev = filp->private_data;
+    struct psdev_data *psdev = container_of(inode->i_cdev, struct psdev_data, cdev);
+    struct psdev_iter *iter = ((struct seq_file *)filp->private_data)->private;
+
     mutex_lock(&psdev->mutex);
-    kfree(psdev->data);
+    put_pid_ns(iter->ns);
+    seq_release_private(inode, filp);
     psdev->is_open = 0;
     mutex_unlock(&psdev->mutex);
-    module_put(THIS_MODULE); // decrease module reference count
 
     return 0;
 }
 
-// read device: lock, copy data to user space, updata file position, unlock
-static ssize_t psdev_read(struct file *filp, char __user *buf, size_t count, loff_t *f_pos) {
-    struct psdev_data *psdev = filp->private_data;
-    ssize_t retval = 0; // how much data to read
-
-    if (*f_pos >= psdev->data_size) {
-        return 0;       // EOF
-    }
-
-    retval = min(count, (size_t)(psdev->data_size - *f_pos));
-    if (copy_to_user(buf, psdev->data + *f_pos, retval)) {  /* print to user space */
-        return -EFAULT;
-    }
-
-    *f_pos += retval;
-    return retval;
-}
-
 static long psdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
     return -ENOTSUPP; // Operation not supported
 }
@@ -200,45 +245,5 @@ static void __exit psdev_exit(void) {
     printk(KERN_INFO "psdev: unregistered devices\n");
 }
 
-static void gather_rt_thread_info(struct psdev_data *dev) {
-    struct task_struct *task, *t;       // task handle process,  t handle thread
-    size_t offset = 0;
-    int buffer_flag = 0;
-
-    rcu_read_lock(); // Start the read-side critical section
-    offset += snprintf(dev->data + offset, MAX_BUFFER_SIZE - offset, 
-                       "%6s %6s %6s %8s\n", "tid", "pid", "pr", "name");
-
-    for_each_process(task) {
-        t = task;
-
-        while(1) {
-            if (t->rt_priority > 0) {       // only print real-time threads
-                offset += snprintf(dev->data + offset, MAX_BUFFER_SIZE - offset,
-                                   "%6d  %6d   %4d   %s\n",
-                                   t->pid, task->tgid, t->rt_priority, t->comm);
-                
-                if (offset >= MAX_BUFFER_SIZE) {
-                    printk(KERN_WARNING "psdev: Buffer size exceeded\n");
-                    buffer_flag = 1;
-                    break;
-                }
-            }
-
-            t = next_thread(t);
-            if (t == task) {
-                break;
-            }
-        }
-
-        if (buffer_flag) {
-            break;
-        }
-    }
-
-    rcu_read_unlock(); // End the read-side critical section 
-    dev->data_size = offset;       
-}
-    
 module_init(psdev_init);
 module_exit(psdev_exit);
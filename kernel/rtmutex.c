@@ -14,6 +14,7 @@
 #include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/timer.h>
+#include <linux/reservation.h>
 
 #include "rtmutex_common.h"
 
@@ -621,6 +622,8 @@ rt_mutex_slowlock(struct rt_mutex *lock, int state,
 		  int detect_deadlock)
 {
 	struct rt_mutex_waiter waiter;
+	struct task_struct *holder;
+	u64 block_start = 0;
 	int ret = 0;
 
 	debug_rt_mutex_init_waiter(&waiter);
@@ -633,6 +636,9 @@ rt_mutex_slowlock(struct rt_mutex *lock, int state,
 		return 0;
 	}
 
+	/* Blocked by a reserved thread: measure it for the rtes blocking terms */
+	holder = blocking_begin(rt_mutex_owner(lock), &block_start);
+
 	set_current_state(state);
 
 	/* Setup the timer, when timeout != NULL */
@@ -660,6 +666,9 @@ rt_mutex_slowlock(struct rt_mutex *lock, int state,
 
 	raw_spin_unlock(&lock->wait_lock);
 
+	if (holder)
+		blocking_end(holder, block_start, ret);
+
 	/* Remove pending timer: */
 	if (unlikely(timeout))
 		hrtimer_cancel(&timeout->timer);
@@ -2495,6 +2495,11 @@ static void ttwu_activate(struct rq *rq, struct task_struct *p, int en_flags)
 	activate_task(rq, p, en_flags);
 	p->on_rq = 1;
 
+	/* CBS reservations may start a new server instance on wakeup */
+	if (p->reservation_data && p->reservation_data->has_reservation &&
+	    p->reservation_data->reserve_type == RESERVE_CBS)
+		cbs_wakeup(p->reservation_data);
+
 	/* if a worker is waking up, notify workqueue */
 	if (p->flags & PF_WQ_WORKER)
 		wq_worker_waking_up(p, cpu_of(rq));
@@ -3075,6 +3080,7 @@ static void finish_task_switch(struct rq *rq, struct task_struct *prev)
 #ifdef __ARCH_WANT_INTERRUPTS_ON_CTXSW
 	local_irq_enable();
 #endif /* __ARCH_WANT_INTERRUPTS_ON_CTXSW */
+	overhead_switch_end();
 	finish_lock_switch(rq, prev);
 	
 	fire_sched_in_preempt_notifiers(current);
@@ -3161,8 +3167,13 @@ context_switch(struct rq *rq, struct task_struct *prev,
 {
 	struct mm_struct *mm, *oldmm;
 	struct timespec now;
+	struct reserve_group *group;
 	u64 delta, budget_ns;		
 
+	/* switch cost of reserved tasks, see rtes/kernel/overhead.c */
+	overhead_switch_begin((prev->reservation_data && prev->reservation_data->has_reservation) ||
+			      (next->reservation_data && next->reservation_data->has_reservation));
+
 	/* accumulator tracker: stop time for previous timer */
 	if (prev && prev->reservation_data && prev->reservation_data->has_reservation) {
         // printk(KERN_INFO "Enter finish task switch for PID %d", prev->pid);
@@ -3181,7 +3192,38 @@ context_switch(struct rq *rq, struct task_struct *prev,
 
 		// After calculating the new accumulated time, check that the task has not exceeded its budget
 		budget_ns = timespec_to_ns(&prev->reservation_data->reserve_C);
-		if (prev->reservation_data->exec_accumulated_time >= budget_ns) {
+		if (prev->reservation_data->split.parts)
+			budget_ns = split_budget_ns(prev->reservation_data);
+		// Shortened by what the last job borrowed, see overrun.c
+		budget_ns -= min(budget_ns, prev->reservation_data->overrun_debt_ns);
+		// Read once, a group is only freed after a grace period of sched RCU, see group.c
+		group = rcu_dereference_sched(prev->reservation_data->group);
+		if (group) {
+			// Members of a group are suspended together once the group used up its budget
+			if (reserve_group_charge(group, delta)) {
+				prev->state = TASK_UNINTERRUPTIBLE;
+				prev->reservation_data->group_suspended = true;
+				set_tsk_need_resched(prev);
+				rtes_event(RTES_EVENT_THROTTLE, prev, prev->reservation_data->reserve_cpu,
+					   prev->reservation_data->exec_accumulated_time);
+			}
+		} else if (prev->reservation_data->reserve_type == RESERVE_CBS) {
+			// A CBS recharges on exhaustion and is only suspended when ahead of its bandwidth
+			if (cbs_charge(prev->reservation_data, delta)) {
+				prev->state = TASK_UNINTERRUPTIBLE;
+				set_tsk_need_resched(prev);
+				rtes_event(RTES_EVENT_THROTTLE, prev, prev->reservation_data->reserve_cpu,
+					   prev->reservation_data->exec_accumulated_time);
+			}
+		} else if (prev->reservation_data->offset_pending) {
+			// Not released yet, the reservation timer wakes it at the end of the release offset
+			prev->state = TASK_UNINTERRUPTIBLE;
+			set_tsk_need_resched(prev);
+		} else if (!prev->reservation_data->profiling &&
+		    prev->reservation_data->exec_accumulated_time >= budget_ns &&
+		    !reclaim_extend(prev->reservation_data, budget_ns) &&
+		    !blocking_extend(prev->reservation_data, budget_ns) &&
+		    overrun_handle(prev->reservation_data, budget_ns)) {
 			printk(KERN_INFO "PID %d exceeded budget, forcing a reschedule!\n", prev->pid);
 			// printk(KERN_INFO "PID %d: exec_accumulated_time: %llu, budget_ns: %llu\n", prev->pid, prev->reservation_data->exec_accumulated_time, budget_ns);
 
@@ -3189,27 +3231,21 @@ context_switch(struct rq *rq, struct task_struct *prev,
 			prev->state = TASK_UNINTERRUPTIBLE;
 			// Force a reschedule
 			set_tsk_need_resched(prev);
-
-			/**
-			// Send SIGEXCESS signal to process
-			struct siginfo info; 
-			memset(&info, 0, sizeof(struct siginfo));
-			info.si_signo = SIGEXCESS;
-			info.si_code = SI_KERNEL;
-
-			if (send_sig_info(SIGEXCESS, &info, task) < 0) {
-				printk(KERN_ERR "Failed to send SIGEXCESS to PID %d\n", task->pid);
-			} else {
-				remove_tid_file(task);
-				cleanup_utilization_data(task);
-				printk(KERN_INFO "SIGEXCESS sent to PID %d\n", task->pid);
-			}
-			**/
+			// Donated slack may wake it before the next release, see reclaim.c
+			reclaim_throttle(prev->reservation_data);
+			rtes_event(RTES_EVENT_THROTTLE, prev, prev->reservation_data->reserve_cpu,
+				   prev->reservation_data->exec_accumulated_time);
+			// SIGEXCESS is sent by overrun_handle through an irq_work, the rq lock is held here
 		}
     }
     /* accumulator tracker: start timer for the next task after finishing task switch */
 	if (next && next->reservation_data && next->reservation_data->has_reservation) {
         getrawmonotonic(&next->reservation_data->exec_start_time);
+        job_switch_in(next->reservation_data);
+        // Out of group budget, it is suspended when switched out
+        group = rcu_dereference_sched(next->reservation_data->group);
+        if (group && group->throttled)
+            set_tsk_need_resched(next);
         // printk(KERN_DEBUG "START timer: prepare_task_switch: PID %d exec_start_time set to %llu\n",
         //        next->pid, timespec_to_ns(&(next->reservation_data->exec_start_time)));
     }
@@ -5110,6 +5146,9 @@ static void
 __setscheduler(struct rq *rq, struct task_struct *p, int policy, int prio)
 {
 	p->policy = policy;
+	/* rtes rt thread counts, only while fork and exit have it counted */
+	if (p->rt_accounted)
+		rt_threads_account(p, p->rt_priority, prio);
 	p->rt_priority = prio;
 	p->normal_prio = normal_prio(p);
 	/* we are holding p->pi_lock already */
@@ -6080,6 +6119,28 @@ void do_set_cpus_allowed(struct task_struct *p, const struct cpumask *new_mask)
 	}
 }
 
+/*
+ * rtes semi-partitioned reservations: pin a task that is not on a runqueue
+ * to @cpu from any context, the next wakeup places it there. Returns -EBUSY
+ * if it is queued or running, the caller then has to go through
+ * set_cpus_allowed_ptr() from process context.
+ */
+int rtes_move_sleeping_task(struct task_struct *p, int cpu)
+{
+	unsigned long flags;
+	struct rq *rq;
+	int ret = 0;
+
+	rq = task_rq_lock(p, &flags);
+	if (p->on_rq || task_running(rq, p))
+		ret = -EBUSY;
+	else
+		do_set_cpus_allowed(p, cpumask_of(cpu));
+	task_rq_unlock(rq, p, &flags);
+
+	return ret;
+}
+
 /*
  * This is how migration works:
  *
@@ -866,6 +866,42 @@ void dec_rt_tasks(struct sched_rt_entity *rt_se, struct rt_rq *rt_rq)
 	dec_rt_group(rt_se, rt_rq);
 }
 
+/*
+ * rtes partitioned EDF: reserved tasks admitted in EDF mode share one rt
+ * priority and are kept sorted by absolute deadline in that priority queue,
+ * ahead of any other task of the same priority.
+ */
+static inline bool rt_se_edf(struct sched_rt_entity *rt_se)
+{
+	struct task_struct *p;
+
+	if (!rt_entity_is_task(rt_se))
+		return false;
+
+	p = rt_task_of(rt_se);
+	return p->reservation_data && p->reservation_data->has_reservation &&
+	       p->reservation_data->edf;
+}
+
+static inline u64 rt_se_deadline(struct sched_rt_entity *rt_se)
+{
+	return rt_task_of(rt_se)->reservation_data->edf_deadline_ns;
+}
+
+static void list_add_rt_edf(struct sched_rt_entity *rt_se, struct list_head *queue)
+{
+	struct sched_rt_entity *pos;
+	u64 deadline = rt_se_deadline(rt_se);
+
+	list_for_each_entry(pos, queue, run_list) {
+		if (!rt_se_edf(pos) || deadline < rt_se_deadline(pos)) {
+			list_add_tail(&rt_se->run_list, &pos->run_list);
+			return;
+		}
+	}
+	list_add_tail(&rt_se->run_list, queue);
+}
+
 static void __enqueue_rt_entity(struct sched_rt_entity *rt_se, bool head)
 {
 	struct rt_rq *rt_rq = rt_rq_of_se(rt_se);
@@ -885,7 +921,9 @@ static void __enqueue_rt_entity(struct sched_rt_entity *rt_se, bool head)
 	if (!rt_rq->rt_nr_running)
 		list_add_leaf_rt_rq(rt_rq);
 
-	if (head)
+	if (rt_se_edf(rt_se))
+		list_add_rt_edf(rt_se, queue);
+	else if (head)
 		list_add(&rt_se->run_list, queue);
 	else
 		list_add_tail(&rt_se->run_list, queue);
@@ -984,7 +1022,10 @@ requeue_rt_entity(struct rt_rq *rt_rq, struct sched_rt_entity *rt_se, int head)
 		struct rt_prio_array *array = &rt_rq->active;
 		struct list_head *queue = array->queue + rt_se_prio(rt_se);
 
-		if (head)
+		if (rt_se_edf(rt_se)) {
+			list_del(&rt_se->run_list);
+			list_add_rt_edf(rt_se, queue);
+		} else if (head)
 			list_move(&rt_se->run_list, queue);
 		else
 			list_move_tail(&rt_se->run_list, queue);
@@ -1095,6 +1136,13 @@ static void check_preempt_curr_rt(struct rq *rq, struct task_struct *p, int flag
 		return;
 	}
 
+	/* rtes EDF: the earlier absolute deadline wins at equal priority */
+	if (p->prio == rq->curr->prio && rt_se_edf(&p->rt) && rt_se_edf(&rq->curr->rt) &&
+	    rt_se_deadline(&p->rt) < rt_se_deadline(&rq->curr->rt)) {
+		resched_task(rq->curr);
+		return;
+	}
+
 #ifdef CONFIG_SMP
 	/*
 	 * If:
@@ -1130,6 +1178,32 @@ static struct sched_rt_entity *pick_next_rt_entity(struct rq *rq,
 	return next;
 }
 
+/*
+ * rtes EDF: move @p to its new absolute deadline, called by the reservation
+ * timer at every release before the task is woken up.
+ */
+void rtes_edf_set_deadline(struct task_struct *p, u64 deadline_ns)
+{
+	struct sched_rt_entity *rt_se = &p->rt;
+	unsigned long flags;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &flags);
+	p->reservation_data->edf_deadline_ns = deadline_ns;
+
+	if (p->on_rq && rt_se_edf(rt_se) && on_rt_rq(rt_se)) {
+		requeue_rt_entity(rt_rq_of_se(rt_se), rt_se, 0);
+
+		if (task_current(rq, p)) {
+			if (pick_next_rt_entity(rq, &rq->rt) != rt_se)
+				resched_task(p);
+		} else if (rq->curr->sched_class == &rt_sched_class) {
+			check_preempt_curr_rt(rq, p, 0);
+		}
+	}
+	task_rq_unlock(rq, p, &flags);
+}
+
 static struct task_struct *_pick_next_task_rt(struct rq *rq)
 {
 	struct sched_rt_entity *rt_se;
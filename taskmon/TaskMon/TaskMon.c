@@ -47,6 +47,7 @@
 #define ENABLED "enabled (1)"
 #define DISABLED "disabled (0)"
 #define UTIL_DIR "/sys/rtes/taskmon/util"
+#define TASKS_DIR "/sys/rtes/tasks"
 
 // Read file
 int read_file(char *filename, char *buffer)
@@ -93,8 +94,9 @@ int print_avg_util(void)
     char buffer[MAX_BUFFER];
     char abs_filepath[MAX_BUFFER];
     char tids_str[MAX_BUFFER] = "";
-    float time_num = 0.0, util_num = 0.0, avg_util = 0.0;
-    int i = 0;
+    float util_num = 0.0, avg_util = 0.0;
+    unsigned long long samples = 0, num;
+    unsigned long long i = 0;
 
     d = opendir(UTIL_DIR);
     if (!d)
@@ -112,30 +114,35 @@ int print_avg_util(void)
             continue;
         strcat(tids_str, dir->d_name); // Append TID to string
         strcat(tids_str, ", ");        // Add comma and space
-        // Convert filename into absolute path
-        snprintf(abs_filepath, sizeof(abs_filepath), "%s/%s", UTIL_DIR, dir->d_name);
-        // Read file content into buffer
+        // The kernel keeps a running summary per TID, so read that instead of every sample
+        snprintf(abs_filepath, sizeof(abs_filepath), "%s/%s/exec_stats", TASKS_DIR, dir->d_name);
         // Open file
         if (!(file = fopen(abs_filepath, "r")))
+        {
             fprintf(stderr, "Failed to open file: %s\n", abs_filepath);
+            continue;
+        }
         // Read file
+        samples = 0;
         while (fgets(buffer, sizeof(buffer), file) != NULL)
         {
-            // Process line: <time> <util>\n
-            if (sscanf(buffer, "%f %f\n", &time_num, &util_num) != 2)
+            // Process lines: samples <n>\n ... util_mean <util>\n
+            if (sscanf(buffer, "samples %llu\n", &num) == 1)
+                samples = num;
+            else if (sscanf(buffer, "util_mean %f\n", &util_num) == 1)
             {
-                perror("Failed to extract values from util/<tid> file\n");
+                // Weight by number of samples so the average covers all data points
+                avg_util += util_num * samples;
+                i += samples; // Track number of entries
             }
-            // Add util to avg
-            avg_util += util_num;
-            i++; // Track number of entries
         }
 
         // Close file
         fclose(file);
     }
     // Take average of util
-    avg_util /= i;
+    if (i > 0)
+        avg_util /= i;
     // Print out average utilization and TIDs
     printf("|   %.2f   | %s \n", avg_util, tids_str);
     closedir(d);